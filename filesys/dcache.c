@@ -0,0 +1,152 @@
+/* dcache.c: Path lookup cache.
+ *
+ * Remembers what a name in a directory resolved to, keyed by the
+ * directory's inode number and the name, so that walking a path that
+ * was walked before neither reads the disk nor opens the directories on
+ * the way.  A name that was not found is remembered too, as a negative
+ * entry.  The cache is a fixed table, so it never allocates memory, and
+ * is replaced in LRU order.
+ *
+ * The directory code keeps it right: adding a name drops its entry,
+ * removing one makes it negative, and creating a directory forgets
+ * everything cached under its inode number, which may have belonged to
+ * a removed directory. */
+
+#include "filesys/dcache.h"
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* Number of cached names. */
+#define DCACHE_SIZE 256
+
+/* Number of hash chains, a power of 2. */
+#define DCACHE_BUCKETS 64
+
+struct dentry {
+	struct list_elem hash_elem;         /* In its bucket, if in use. */
+	struct list_elem lru_elem;          /* In lru, most recent first. */
+	bool in_use;
+	disk_sector_t parent;               /* Directory that holds NAME. */
+	char name[NAME_MAX + 1];
+	disk_sector_t inumber;              /* 0 if NAME is not in PARENT. */
+	bool is_dir;
+};
+
+static struct dentry dentries[DCACHE_SIZE];
+static struct list buckets[DCACHE_BUCKETS];
+static struct list lru;                 /* Every dentry, unused ones last. */
+static struct lock dcache_lock;
+
+void
+dcache_init (void) {
+	lock_init (&dcache_lock);
+	list_init (&lru);
+	for (size_t i = 0; i < DCACHE_BUCKETS; i++)
+		list_init (&buckets[i]);
+	for (size_t i = 0; i < DCACHE_SIZE; i++) {
+		dentries[i].in_use = false;
+		list_push_back (&lru, &dentries[i].lru_elem);
+	}
+}
+
+static struct list *
+bucket (disk_sector_t parent, const char *name) {
+	uint64_t hash = hash_string (name) ^ hash_int (parent);
+	return &buckets[hash & (DCACHE_BUCKETS - 1)];
+}
+
+/* Returns the dentry for NAME in PARENT, or NULL.
+ * Caller holds dcache_lock. */
+static struct dentry *
+dentry_find (disk_sector_t parent, const char *name) {
+	struct list *b = bucket (parent, name);
+
+	for (struct list_elem *e = list_begin (b); e != list_end (b);
+			e = list_next (e)) {
+		struct dentry *d = list_entry (e, struct dentry, hash_elem);
+		if (d->parent == parent && !strcmp (d->name, name))
+			return d;
+	}
+	return NULL;
+}
+
+/* Frees D, which goes to the back of the LRU list to be reused first.
+ * Caller holds dcache_lock. */
+static void
+dentry_drop (struct dentry *d) {
+	list_remove (&d->hash_elem);
+	d->in_use = false;
+	list_remove (&d->lru_elem);
+	list_push_back (&lru, &d->lru_elem);
+}
+
+/* Looks up NAME in the directory with inode number PARENT.  Returns
+ * false if the cache does not know.  Otherwise returns true and sets
+ * *INUMBER to the inode number NAME resolves to, or 0 if PARENT has no
+ * NAME, and *IS_DIR to whether that is a directory. */
+bool
+dcache_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *inumber, bool *is_dir) {
+	lock_acquire (&dcache_lock);
+	struct dentry *d = dentry_find (parent, name);
+	if (d != NULL) {
+		*inumber = d->inumber;
+		*is_dir = d->is_dir;
+		list_remove (&d->lru_elem);
+		list_push_front (&lru, &d->lru_elem);
+	}
+	lock_release (&dcache_lock);
+	return d != NULL;
+}
+
+/* Remembers that NAME in the directory with inode number PARENT
+ * resolves to INUMBER, or to nothing if INUMBER is 0.  Names too long
+ * to be in a directory are not cached. */
+void
+dcache_insert (disk_sector_t parent, const char *name,
+		disk_sector_t inumber, bool is_dir) {
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	struct dentry *d = dentry_find (parent, name);
+	if (d == NULL) {
+		d = list_entry (list_back (&lru), struct dentry, lru_elem);
+		if (d->in_use)
+			list_remove (&d->hash_elem);
+		d->in_use = true;
+		d->parent = parent;
+		strlcpy (d->name, name, sizeof d->name);
+		list_push_front (bucket (parent, name), &d->hash_elem);
+	}
+	d->inumber = inumber;
+	d->is_dir = is_dir;
+	list_remove (&d->lru_elem);
+	list_push_front (&lru, &d->lru_elem);
+	lock_release (&dcache_lock);
+}
+
+/* Forgets what NAME in the directory with inode number PARENT resolves
+ * to. */
+void
+dcache_invalidate (disk_sector_t parent, const char *name) {
+	lock_acquire (&dcache_lock);
+	struct dentry *d = dentry_find (parent, name);
+	if (d != NULL)
+		dentry_drop (d);
+	lock_release (&dcache_lock);
+}
+
+/* Forgets every name cached in the directory with inode number
+ * PARENT. */
+void
+dcache_purge (disk_sector_t parent) {
+	lock_acquire (&dcache_lock);
+	for (size_t i = 0; i < DCACHE_SIZE; i++)
+		if (dentries[i].in_use && dentries[i].parent == parent)
+			dentry_drop (&dentries[i]);
+	lock_release (&dcache_lock);
+}
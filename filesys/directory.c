@@ -1,16 +1,59 @@
 #include "filesys/directory.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
 #include "filesys/fat.h"
 
+/* A directory is a file of dir_entry records, in readdir order.  Once
+ * it has DIR_INDEX_MIN entries it also gets a hash index, a file of its
+ * own that maps names to entry numbers, so that lookups read a slot or
+ * two instead of every entry.  The entries stay where they are, so the
+ * readdir order is that of a directory without an index: a new entry
+ * takes the place of a removed one, or goes at the end.  Directories
+ * without an index, such as small ones and those written before indexes
+ * existed, are searched linearly. */
+
+/* Entries a directory has when it gets an index. */
+#define DIR_INDEX_MIN 64
+
+/* Identifies a directory index. */
+#define DIR_INDEX_MAGIC 0x44494458
+
+/* Slot of a removed entry.  The probe goes on past it. */
+#define DIR_INDEX_DEAD UINT32_MAX
+
+/* Start of a directory index.  Its slots follow from the next sector on,
+ * an open-addressed hash table probed linearly. */
+struct dir_index_head {
+	uint32_t magic;
+	uint32_t slot_cnt;                  /* Power of 2. */
+	uint32_t used;                      /* Slots that refer to an entry. */
+	uint32_t dead;                      /* DIR_INDEX_DEAD slots. */
+	uint32_t free_head;                 /* 1 + number of the first free
+	                                       entry, or 0 if none is. */
+};
+
+/* A slot of a directory index.  ENTRY is 1 + the number of the entry
+ * whose name hashes to HASH, 0 if the slot is empty, or DIR_INDEX_DEAD.
+ * The free entries of an indexed directory are chained through their
+ * inode_sector fields in the same way. */
+struct dir_index_slot {
+	uint32_t hash;
+	uint32_t entry;
+};
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (disk_sector_t sector, size_t entry_cnt) {
+	/* SECTOR may have held a directory that was removed. */
+	dcache_purge (sector);
 	return inode_create (sector, entry_cnt * sizeof (struct dir_entry), 1);
 }
 
@@ -35,7 +78,7 @@ dir_open (struct inode *inode) {
 struct dir *
 dir_open_root (void) {
 
-	return dir_open (inode_open (cluster_to_sector(ROOT_DIR_CLUSTER)));
+	return dir_open (inode_open (ROOT_DIR_CLUSTER));
 }
 
 /* Opens and returns a new directory for the same inode as DIR.
@@ -60,6 +103,231 @@ dir_get_inode (struct dir *dir) {
 	return dir->inode;
 }
 
+/* Returns the hash of NAME in a directory index. */
+static uint32_t
+index_hash (const char *name) {
+	uint64_t hash = hash_string (name);
+	return hash ^ (hash >> 32);
+}
+
+/* Returns the byte offset of slot I within a directory index. */
+static off_t
+index_slot_ofs (uint32_t i) {
+	return DISK_SECTOR_SIZE + i * sizeof (struct dir_index_slot);
+}
+
+/* Returns the number of slots for an index of CNT entries, a power of 2
+ * at least twice CNT. */
+static uint32_t
+index_slots (uint32_t cnt) {
+	uint32_t slots = 2 * DIR_INDEX_MIN;
+
+	while (slots < 2 * cnt)
+		slots *= 2;
+	return slots;
+}
+
+/* Opens DIR's index.  Returns a null pointer if it has none. */
+static struct inode *
+index_open (const struct dir *dir) {
+	disk_sector_t index = inode_get_dir_index (dir->inode);
+	return index != 0 ? inode_open (index) : NULL;
+}
+
+static bool
+index_read_head (struct inode *index, struct dir_index_head *h) {
+	return inode_read_at (index, h, sizeof *h, 0) == sizeof *h
+		&& h->magic == DIR_INDEX_MAGIC;
+}
+
+static bool
+index_write_head (struct inode *index, const struct dir_index_head *h) {
+	return inode_write_at (index, h, sizeof *h, 0) == sizeof *h;
+}
+
+/* Makes ENTRY the entry for HASH in INDEX, whose head is H, in the first
+ * empty or dead slot of the probe.  The caller writes H back. */
+static bool
+index_insert (struct inode *index, struct dir_index_head *h, uint32_t hash,
+		uint32_t entry) {
+	struct dir_index_slot slot;
+	uint32_t mask = h->slot_cnt - 1;
+	uint32_t i = hash & mask;
+
+	for (;; i = (i + 1) & mask) {
+		if (inode_read_at (index, &slot, sizeof slot, index_slot_ofs (i))
+				!= sizeof slot)
+			return false;
+		if (slot.entry == 0 || slot.entry == DIR_INDEX_DEAD)
+			break;
+	}
+	if (slot.entry == DIR_INDEX_DEAD)
+		h->dead--;
+	h->used++;
+	slot.hash = hash;
+	slot.entry = entry;
+	return inode_write_at (index, &slot, sizeof slot, index_slot_ofs (i))
+		== sizeof slot;
+}
+
+/* Gives DIR a new index of SLOT_CNT slots built from its entries, in
+ * place of the one it has, if any.  Chains its free entries for reuse.
+ * Returns false, leaving DIR as it was, if the disk is full. */
+static bool
+index_build (struct dir *dir, uint32_t slot_cnt) {
+	struct dir_index_head h = {
+		.magic = DIR_INDEX_MAGIC,
+		.slot_cnt = slot_cnt,
+	};
+	struct inode *index = NULL;
+	struct dir_entry e;
+	bool success = false;
+	uint32_t n;
+
+	cluster_t clst = fat_create_chain (0);
+	if (clst == 0)
+		return false;
+	if (!inode_create (clst, index_slot_ofs (slot_cnt), 0)
+			|| (index = inode_open (clst)) == NULL) {
+		fat_remove_chain (clst, 0);
+		return false;
+	}
+
+	for (n = 0; inode_read_at (dir->inode, &e, sizeof e, n * sizeof e)
+			== sizeof e; n++) {
+		if (e.in_use) {
+			if (!index_insert (index, &h, index_hash (e.name), n + 1))
+				goto done;
+		} else {
+			e.inode_sector = h.free_head;
+			if (inode_write_at (dir->inode, &e, sizeof e, n * sizeof e)
+					!= sizeof e)
+				goto done;
+			h.free_head = n + 1;
+		}
+	}
+	if (!index_write_head (index, &h))
+		goto done;
+
+	/* Switch over, then drop the old index. */
+	struct inode *old = index_open (dir);
+	inode_set_dir_index (dir->inode, clst);
+	if (old != NULL) {
+		inode_remove (old);
+		inode_close (old);
+	}
+	success = true;
+
+done:
+	if (!success)
+		inode_remove (index);
+	inode_close (index);
+	return success;
+}
+
+/* Searches DIR, whose index is INDEX, for NAME, as lookup() does.  Also
+ * sets *SLOTP to the number of its slot in INDEX if SLOTP is
+ * non-null. */
+static bool
+index_lookup (const struct dir *dir, struct inode *index, const char *name,
+		struct dir_entry *ep, off_t *ofsp, uint32_t *slotp) {
+	struct dir_index_head h;
+	struct dir_index_slot slot;
+	struct dir_entry e;
+
+	if (!index_read_head (index, &h))
+		return false;
+
+	uint32_t hash = index_hash (name);
+	uint32_t mask = h.slot_cnt - 1;
+	uint32_t i = hash & mask;
+	for (uint32_t n = 0; n < h.slot_cnt; n++, i = (i + 1) & mask) {
+		if (inode_read_at (index, &slot, sizeof slot, index_slot_ofs (i))
+				!= sizeof slot || slot.entry == 0)
+			return false;
+		if (slot.entry == DIR_INDEX_DEAD || slot.hash != hash)
+			continue;
+
+		off_t ofs = (slot.entry - 1) * sizeof e;
+		if (inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e
+				&& e.in_use && !strcmp (name, e.name)) {
+			if (ep != NULL)
+				*ep = e;
+			if (ofsp != NULL)
+				*ofsp = ofs;
+			if (slotp != NULL)
+				*slotp = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Adds NAME, with its inode in INODE_SECTOR, to DIR, whose index is
+ * INDEX.  The new entry takes the place of the last one removed, or goes
+ * at the end.  NAME must not be in DIR. */
+static bool
+index_add (struct dir *dir, struct inode *index, const char *name,
+		disk_sector_t inode_sector) {
+	struct dir_index_head h;
+	struct dir_entry e;
+	uint32_t next = 0;
+	off_t ofs;
+
+	/* The index is rebuilt before it fills up, unless that failed. */
+	if (!index_read_head (index, &h) || h.used + h.dead + 1 >= h.slot_cnt)
+		return false;
+
+	if (h.free_head != 0) {
+		ofs = (h.free_head - 1) * sizeof e;
+		if (inode_read_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+			return false;
+		next = e.inode_sector;
+	} else
+		ofs = inode_length (dir->inode);
+
+	e.in_use = true;
+	strlcpy (e.name, name, sizeof e.name);
+	e.inode_sector = inode_sector;
+	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+		return false;
+	h.free_head = next;
+	if (!index_insert (index, &h, index_hash (name), ofs / sizeof e + 1)
+			|| !index_write_head (index, &h))
+		return false;
+
+	/* Keep the index at most 3/4 full, counting dead slots.  It may stay
+	 * the same size if dead slots are what filled it. */
+	if ((h.used + h.dead) * 4 > h.slot_cnt * 3)
+		index_build (dir, index_slots (h.used));
+	return true;
+}
+
+/* Erases the entry for NAME in DIR, whose index is INDEX, and chains it
+ * for reuse. */
+static bool
+index_remove (struct dir *dir, struct inode *index, const char *name) {
+	struct dir_index_head h;
+	struct dir_index_slot slot = { .entry = DIR_INDEX_DEAD };
+	struct dir_entry e;
+	uint32_t i;
+	off_t ofs;
+
+	if (!index_read_head (index, &h)
+			|| !index_lookup (dir, index, name, &e, &ofs, &i))
+		return false;
+
+	e.in_use = false;
+	e.inode_sector = h.free_head;
+	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+		return false;
+	h.free_head = ofs / sizeof e + 1;
+	h.used--;
+	h.dead++;
+	return inode_write_at (index, &slot, sizeof slot, index_slot_ofs (i))
+		== sizeof slot && index_write_head (index, &h);
+}
+
 /* Searches DIR for a file with the given NAME.
  * If successful, returns true, sets *EP to the directory entry
  * if EP is non-null, and sets *OFSP to the byte offset of the
@@ -74,6 +342,13 @@ lookup (const struct dir *dir, const char *name,
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
+	struct inode *index = index_open (dir);
+	if (index != NULL) {
+		bool found = index_lookup (dir, index, name, ep, ofsp, NULL);
+		inode_close (index);
+		return found;
+	}
+
 	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 			ofs += sizeof e)
 		if (e.in_use && !strcmp (name, e.name)) {
@@ -86,6 +361,33 @@ lookup (const struct dir *dir, const char *name,
 	return false;
 }
 
+/* Searches DIR for NAME through the dentry cache.  If it is there,
+ * returns true and sets *INUMBER to its inode number and *IS_DIR to
+ * whether it is a directory.  Reads the directory only on a miss, and
+ * caches what it found, or that NAME is not there. */
+static bool
+lookup_cached (const struct dir *dir, const char *name,
+		disk_sector_t *inumber, bool *is_dir) {
+	disk_sector_t parent = inode_get_inumber (dir->inode);
+	struct dir_entry e;
+
+	if (dcache_lookup (parent, name, inumber, is_dir))
+		return *inumber != 0;
+
+	*inumber = 0;
+	*is_dir = false;
+	if (lookup (dir, name, &e, NULL)) {
+		struct inode *inode = inode_open (e.inode_sector);
+		if (inode == NULL)
+			return false;
+		*inumber = e.inode_sector;
+		*is_dir = inode_is_dir (inode);
+		inode_close (inode);
+	}
+	dcache_insert (parent, name, *inumber, *is_dir);
+	return *inumber != 0;
+}
+
 /* Searches DIR for a file with the given NAME
  * and returns true if one exists, false otherwise.
  * On success, sets *INODE to an inode for the file, otherwise to
@@ -93,19 +395,40 @@ lookup (const struct dir *dir, const char *name,
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
-	struct dir_entry e;
+	disk_sector_t inumber;
+	bool is_dir;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
+	if (lookup_cached (dir, name, &inumber, &is_dir))
+		*inode = inode_open (inumber);
 	else
 		*inode = NULL;
 
 	return *inode != NULL;
 }
 
+/* Searches the directory whose inode number is PARENT for NAME, like
+ * dir_lookup(), but returns its inode number in *INUMBER, and whether
+ * it is a directory in *IS_DIR, instead of opening it.  Opens PARENT
+ * only if the dentry cache does not know the answer. */
+bool
+dir_resolve (disk_sector_t parent, const char *name,
+		disk_sector_t *inumber, bool *is_dir) {
+	ASSERT (name != NULL);
+
+	if (dcache_lookup (parent, name, inumber, is_dir))
+		return *inumber != 0;
+
+	struct dir *dir = dir_open (inode_open (parent));
+	if (dir == NULL)
+		return false;
+	bool found = lookup_cached (dir, name, inumber, is_dir);
+	dir_close (dir);
+	return found;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
  * file by that name.  The file's inode is in sector
  * INODE_SECTOR.
@@ -115,6 +438,7 @@ dir_lookup (const struct dir *dir, const char *name,
 bool
 dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	struct dir_entry e;
+	struct inode *index = NULL;
 	off_t ofs;
 	bool success = false;
 
@@ -129,6 +453,12 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
 
+	index = index_open (dir);
+	if (index != NULL) {
+		success = index_add (dir, index, name, inode_sector);
+		goto done;
+	}
+
 	/* Set OFS to offset of free slot.
 	 * If there are no free slots, then it will be set to the
 	 * current end-of-file.
@@ -146,7 +476,16 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	strlcpy (e.name, name, sizeof e.name);
 	e.inode_sector = inode_sector;
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+
+	/* A directory that has grown large gets an index.  Without one it
+	 * still works, only slower. */
+	if (success && ofs / sizeof e + 1 >= DIR_INDEX_MIN)
+		index_build (dir, index_slots (ofs / sizeof e + 1));
 done:
+	/* Drop a negative dentry for NAME. */
+	if (success)
+		dcache_invalidate (inode_get_inumber (dir->inode), name);
+	inode_close (index);
 	return success;
 }
 
@@ -157,6 +496,7 @@ bool
 dir_remove (struct dir *dir, const char *name) {
 	struct dir_entry e;
 	struct inode *inode = NULL;
+	struct inode *index = NULL;
 	bool success = false;
 	off_t ofs;
 
@@ -173,15 +513,23 @@ dir_remove (struct dir *dir, const char *name) {
 		goto done;
 
 	/* Erase directory entry. */
-	e.in_use = false;
-	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
-		goto done;
+	index = index_open (dir);
+	if (index != NULL) {
+		if (!index_remove (dir, index, name))
+			goto done;
+	} else {
+		e.in_use = false;
+		if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
+			goto done;
+	}
 
 	/* Remove inode. */
 	inode_remove (inode);
+	dcache_insert (inode_get_inumber (dir->inode), name, 0, false);
 	success = true;
 
 done:
+	inode_close (index);
 	inode_close (inode);
 	return success;
 }
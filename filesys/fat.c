@@ -1,6 +1,8 @@
 #include "filesys/fat.h"
+#include <bitmap.h>
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/page_cache.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
 #include <stdio.h>
@@ -9,7 +11,7 @@
 /* Should be less than DISK_SECTOR_SIZE */
 struct fat_boot {
 	unsigned int magic;
-	unsigned int sectors_per_cluster; /* Fixed to 1 */ 
+	unsigned int sectors_per_cluster; /* Chosen at format time. */
 	unsigned int total_sectors;
 	unsigned int fat_start;
 	unsigned int fat_sectors; /* Size of FAT in sectors. */
@@ -22,20 +24,32 @@ struct fat_fs {
 	unsigned int *fat;
 	unsigned int fat_length;
 	disk_sector_t data_start;
-	cluster_t last_clst;
-	struct lock write_lock;
+	cluster_t clst_cnt;         /* Clusters that fit on the disk. */
+	cluster_t last_clst;        /* Where the next-fit search starts. */
+	struct bitmap *free_map;    /* Clusters in use, mirrors fat[]. */
+	struct bitmap *dirty_map;   /* FAT sectors newer in fat[] than on disk. */
+	struct lock write_lock;     /* Protects free_map, dirty_map and chain
+	                               updates. */
 };
 
+/* FAT entries in one sector of the FAT. */
+#define FAT_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (cluster_t))
+
 static struct fat_fs *fat_fs;
 
+unsigned int fat_format_cluster_sectors = 1;
+
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_free_map_init (void);
+static void fat_table_alloc (void);
 
 void
 fat_init (void) {
 	fat_fs = calloc (1, sizeof (struct fat_fs));
 	if (fat_fs == NULL)
 		PANIC ("FAT init failed");
+	lock_init (&fat_fs->write_lock);
 
 	// Read boot sector from the disk
 	unsigned int *bounce = malloc (DISK_SECTOR_SIZE);
@@ -53,31 +67,12 @@ fat_init (void) {
 
 void
 fat_open (void) {
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT load failed");
+	fat_table_alloc ();
 
-	// Load FAT directly from the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
-	}
+	// Load FAT directly from the disk, as few commands as possible
+	disk_read_multiple (filesys_disk, fat_fs->bs.fat_start, fat_fs->fat,
+			fat_fs->bs.fat_sectors);
+	fat_free_map_init ();
 }
 
 void
@@ -90,27 +85,41 @@ fat_close (void) {
 	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
 	free (bounce);
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
+	// Write the FAT sectors that changed
+	fat_writeback ();
+}
+
+/* Allocates fat[], rounded up to whole sectors so that each FAT
+ * sector can be read and written in place, and the map of its dirty
+ * sectors. */
+static void
+fat_table_alloc (void) {
+	fat_fs->fat = calloc (fat_fs->bs.fat_sectors, DISK_SECTOR_SIZE);
+	fat_fs->dirty_map = bitmap_create (fat_fs->bs.fat_sectors);
+	if (fat_fs->fat == NULL || fat_fs->dirty_map == NULL)
+		PANIC ("FAT load failed");
+}
+
+/* Writes the FAT sectors changed since they were last written, each
+ * run of consecutive ones with a single disk command. */
+void
+fat_writeback (void) {
+	if (fat_fs == NULL || fat_fs->dirty_map == NULL)
+		return;
+
+	lock_acquire (&fat_fs->write_lock);
+	struct bitmap *dirty = fat_fs->dirty_map;
+	size_t i = 0;
+	while ((i = bitmap_scan (dirty, i, 1, true)) != BITMAP_ERROR) {
+		size_t end = bitmap_scan (dirty, i, 1, false);
+		if (end == BITMAP_ERROR)
+			end = bitmap_size (dirty);
+		bitmap_set_multiple (dirty, i, end - i, false);
+		disk_write_multiple (filesys_disk, fat_fs->bs.fat_start + i,
+				(uint8_t *) fat_fs->fat + i * DISK_SECTOR_SIZE, end - i);
+		i = end;
 	}
+	lock_release (&fat_fs->write_lock);
 }
 
 void
@@ -119,10 +128,10 @@ fat_create (void) {
 	fat_boot_create ();
 	fat_fs_init ();
 
-	// Create FAT table
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT creation failed");
+	// Create FAT table, all of which has to reach the disk
+	fat_table_alloc ();
+	bitmap_set_all (fat_fs->dirty_map, true);
+	fat_free_map_init ();
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
@@ -131,18 +140,24 @@ fat_create (void) {
 	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
 	if (buf == NULL)
 		PANIC ("FAT create failed due to OOM");
-	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
+	for (unsigned i = 0; i < fat_cluster_sectors (); i++)
+		page_cache_write (cluster_to_sector (ROOT_DIR_CLUSTER) + i, buf, 0,
+				DISK_SECTOR_SIZE);
 	free (buf);
 }
 
 void
 fat_boot_create (void) {
+	unsigned int spc = fat_format_cluster_sectors;
+	if (spc == 0 || spc > MAX_SECTORS_PER_CLUSTER || (spc & (spc - 1)) != 0)
+		PANIC ("bad cluster size: %u sectors", spc);
+
 	unsigned int fat_sectors =
 	    (disk_size (filesys_disk) - 1)
-	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
+	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * spc + 1) + 1;
 	fat_fs->bs = (struct fat_boot){
 	    .magic = FAT_MAGIC,
-	    .sectors_per_cluster = SECTORS_PER_CLUSTER,
+	    .sectors_per_cluster = spc,
 	    .total_sectors = disk_size (filesys_disk),
 	    .fat_start = 1,
 	    .fat_sectors = fat_sectors,
@@ -153,8 +168,55 @@ fat_boot_create (void) {
 void
 fat_fs_init (void) {
 	/* TODO: Your code goes here. */
-	fat_fs->fat_length = fat_fs->bs.fat_sectors * DISK_SECTOR_SIZE/(sizeof(cluster_t)*SECTORS_PER_CLUSTER);
+	fat_fs->fat_length = fat_fs->bs.fat_sectors * FAT_PER_SECTOR;
 	fat_fs->data_start = fat_fs->bs.fat_start+fat_fs->bs.fat_sectors;
+
+	/* The FAT is rounded up to whole sectors, so its tail may describe
+	 * clusters past the end of the disk. */
+	cluster_t disk_clusters = (fat_fs->bs.total_sectors - fat_fs->data_start)
+		/ fat_fs->bs.sectors_per_cluster;
+	fat_fs->clst_cnt = fat_fs->fat_length;
+	if (disk_clusters < fat_fs->clst_cnt)
+		fat_fs->clst_cnt = disk_clusters;
+}
+
+/* Builds the free-cluster bitmap from the FAT.  Cluster 0 stands for
+ * "no cluster" and is never handed out. */
+static void
+fat_free_map_init (void) {
+	fat_fs->free_map = bitmap_create (fat_fs->clst_cnt);
+	if (fat_fs->free_map == NULL)
+		PANIC ("FAT free map creation failed");
+	bitmap_mark (fat_fs->free_map, 0);
+	for (cluster_t clst = 1; clst < fat_fs->clst_cnt; clst++)
+		if (fat_fs->fat[clst] != 0)
+			bitmap_mark (fat_fs->free_map, clst);
+	fat_fs->last_clst = ROOT_DIR_CLUSTER + 1;
+}
+
+/* Takes CNT free clusters in a row: the ones from GOAL if they are all
+ * free, otherwise the next such run from where the last search stopped.
+ * Returns the first one, or 0 if there is no such run.
+ * Caller holds write_lock. */
+static cluster_t
+fat_alloc (cluster_t goal, size_t cnt) {
+	struct bitmap *map = fat_fs->free_map;
+	size_t clst;
+
+	if (goal != 0 && goal + cnt <= fat_fs->clst_cnt
+			&& bitmap_none (map, goal, cnt))
+		clst = goal;
+	else {
+		if (fat_fs->last_clst >= fat_fs->clst_cnt)
+			fat_fs->last_clst = 0;
+		clst = bitmap_scan (map, fat_fs->last_clst, cnt, false);
+		if (clst == BITMAP_ERROR)
+			clst = bitmap_scan (map, 0, cnt, false);
+		if (clst == BITMAP_ERROR)
+			return 0;
+	}
+	fat_fs->last_clst = clst + cnt;
+	return clst;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -167,23 +229,64 @@ fat_fs_init (void) {
 
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
-	int index = 2;
-	while (fat_fs->fat[index] != 0 && index < fat_fs->fat_length)
-	{
-		index++;
-	}
-	fat_put(index,EOChain);
-	if(clst == 0){
-		return index;
+	return fat_create_chain_multiple (clst, 1);
+}
+
+/* Adds CNT clusters to the chain, in one run of consecutive clusters if
+ * there is one.  If CLST is 0, starts a new chain.  Returns the first
+ * new cluster, or 0, with the chain left alone, if the disk does not
+ * have CNT free clusters. */
+cluster_t
+fat_create_chain_multiple (cluster_t clst, size_t cnt) {
+	ASSERT (cnt > 0);
+	lock_acquire (&fat_fs->write_lock);
+
+	/* Callers growing a file pass its last cluster, so this walk is
+	 * normally empty. */
+	if (clst != 0)
+		while (fat_get (clst) != EOChain)
+			clst = fat_get (clst);
+
+	/* Going right after the tail keeps the file contiguous. */
+	cluster_t first = fat_alloc (clst != 0 ? clst + 1 : 0, cnt);
+	if (first != 0) {
+		for (cluster_t c = first; c < first + cnt; c++)
+			fat_put (c, c + 1 < first + cnt ? c + 1 : EOChain);
+	} else if (cnt > 1 && bitmap_count (fat_fs->free_map, 0, fat_fs->clst_cnt,
+				false) >= cnt) {
+		/* No run is long enough: take the clusters one by one. */
+		cluster_t prev = 0;
+		for (size_t i = 0; i < cnt; i++) {
+			cluster_t c = fat_alloc (prev != 0 ? prev + 1 : clst + 1, 1);
+			fat_put (c, EOChain);
+			if (prev != 0)
+				fat_put (prev, c);
+			else
+				first = c;
+			prev = c;
+		}
 	}
-	while (fat_get(clst) != EOChain)
-	{
-		clst = fat_get(clst);
-		
+	if (first != 0 && clst != 0)
+		fat_put (clst, first);
+
+	lock_release (&fat_fs->write_lock);
+	return first;
+}
+
+/* Returns the number of runs of consecutive clusters in the chain from
+ * CLST, and its length in *CNT. */
+size_t
+fat_chain_runs (cluster_t clst, size_t *cnt) {
+	size_t runs = 0;
+
+	*cnt = 0;
+	for (cluster_t prev = 0; clst != 0 && clst != EOChain;
+			prev = clst, clst = fat_get (clst)) {
+		if (prev == 0 || clst != prev + 1)
+			runs++;
+		(*cnt)++;
 	}
-	fat_put(clst,index);
-	return index;
+	return runs;
 }
 
 /* Remove the chain of clusters starting from CLST.*/
@@ -192,6 +295,7 @@ fat_remove_chain (cluster_t clst, cluster_t pclst) {
     /* TODO: Your code goes here. */
     cluster_t next_clst;
     // print_fat();
+    lock_acquire (&fat_fs->write_lock);
     if(pclst!=0){
         while (true){
             next_clst = fat_get(clst);
@@ -222,6 +326,7 @@ fat_remove_chain (cluster_t clst, cluster_t pclst) {
             }
         }
     }
+    lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
@@ -229,7 +334,11 @@ void
 fat_put (cluster_t clst, cluster_t val) {
 	/* TODO: Your code goes here. */
 	// ASSERT(clst >= 1);
+	ASSERT (clst < fat_fs->fat_length);
 	fat_fs->fat[clst] = val;
+	bitmap_mark (fat_fs->dirty_map, clst / FAT_PER_SECTOR);
+	if (clst < fat_fs->clst_cnt)
+		bitmap_set (fat_fs->free_map, clst, val != 0);
 }
 
 /* Fetch a value in the FAT table. */
@@ -240,16 +349,24 @@ fat_get (cluster_t clst) {
 	return fat_fs->fat[clst];
 }
 
+/* Returns the number of sectors in a cluster of the mounted file
+ * system. */
+unsigned int
+fat_cluster_sectors (void) {
+	return fat_fs->bs.sectors_per_cluster;
+}
+
 /* Covert a cluster # to a sector number. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
 	/* TODO: Your code goes here. */
-	return fat_fs->data_start + (clst * SECTORS_PER_CLUSTER);
+	return fat_fs->data_start + (clst * fat_fs->bs.sectors_per_cluster);
 }
 
+/* Returns the cluster that holds SECTOR, a sector of the data area. */
 cluster_t sector_to_cluster (disk_sector_t sector){
 	
-	return sector - (fat_fs->data_start * SECTORS_PER_CLUSTER);
+	return (sector - fat_fs->data_start) / fat_fs->bs.sectors_per_cluster;
 }
 
 void print_fat(){
@@ -109,6 +109,24 @@ file_write_at (struct file *file, const void *buffer, off_t size,
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Allocates disk space for the LEN bytes of FILE from OFFSET, so that
+ * writing them cannot run out of space, extending FILE with zeros if it
+ * ends before OFFSET + LEN.  Returns false if the disk is full or writes
+ * to FILE are denied. */
+bool
+file_allocate (struct file *file, off_t offset, off_t len) {
+	ASSERT (file != NULL);
+	ASSERT (offset >= 0 && len >= 0);
+	return inode_allocate (file->inode, offset + len);
+}
+
+/* Writes FILE's data and metadata to disk. */
+void
+file_sync (struct file *file) {
+	ASSERT (file != NULL);
+	inode_sync (file->inode);
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 void
@@ -7,9 +7,10 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "devices/disk.h"
+#include "filesys/dcache.h"
 #include "filesys/fat.h"
+#include "filesys/page_cache.h"
 #include "threads/thread.h"
-#include "filesys/inode.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
@@ -25,6 +26,8 @@ filesys_init (bool format) {
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
 	inode_init ();
+	dcache_init ();
+	page_cache_init ();
 
 #ifdef EFILESYS
 	fat_init ();
@@ -50,6 +53,8 @@ filesys_init (bool format) {
  * to disk. */
 void
 filesys_done (void) {
+	inode_done ();
+	page_cache_writeback ();
 	/* Original FS */
 #ifdef EFILESYS
 	fat_close ();
@@ -64,18 +69,13 @@ filesys_done (void) {
  * or if internal memory allocation fails. */
 bool
 filesys_create (const char *name, off_t initial_size) {
-	bool success = false;
-
 	#ifdef EFILESYS
-	char *cp_name = (char *)malloc(strlen(name) + 1);
-	strlcpy(cp_name, name, strlen(name) + 1);
+	char file_name[NAME_MAX + 1];
+	struct dir *dir = parse_path(name, file_name);
 
-	char *file_name = (char *)malloc(strlen(name) + 1);
-	struct dir *dir = parse_path(cp_name, file_name);
+	cluster_t inode_cluster = dir != NULL ? fat_create_chain(0) : 0;
 
-	cluster_t inode_cluster = fat_create_chain(0);
-
-	success = (dir != NULL && inode_create(inode_cluster, initial_size, 0) && dir_add(dir, file_name, inode_cluster));
+	bool success = (inode_cluster != 0 && inode_create(inode_cluster, initial_size, 0) && dir_add(dir, file_name, inode_cluster));
 			  // file의 inode를 생성하고 디렉토리에 추가한다.
 
 	if (!success && inode_cluster != 0) {
@@ -83,8 +83,6 @@ filesys_create (const char *name, off_t initial_size) {
 	}
 
 	dir_close(dir);
-	free(cp_name);
-	free(file_name);
 
 	return success;
 
@@ -109,30 +107,15 @@ filesys_create (const char *name, off_t initial_size) {
 struct file *filesys_open (const char *name) {
     #ifdef EFILESYS
 
-    // name의 파일경로를 cp_name에 복사
-    char* cp_name = (char *)malloc(strlen(name) + 1);
-    char* file_name = (char *)malloc(strlen(name) + 1);
-
-    struct dir* dir = NULL;
+    // name의 경로를 분석해 마지막 이름을 file_name에 받는다.
+    char file_name[NAME_MAX + 1];
+    struct dir* dir = parse_path(name, file_name);
     struct inode *inode = NULL;
 
-    while(true) {
-        strlcpy(cp_name, name, strlen(name) + 1);
-        // cp_name의경로분석
-        dir = parse_path(cp_name, file_name);
-
-        if (dir != NULL) {
-            dir_lookup(dir, file_name, &inode);
-            if(inode) {   // 파일이 존재하고, 링크 파일인 경우
-                dir_close(dir);
-                continue;
-            }
-        }
-        free(cp_name);
-        free(file_name);
-        dir_close(dir);
-        break;
-    }
+    if (dir != NULL)
+        dir_lookup(dir, file_name, &inode);
+    dir_close(dir);
+
     return file_open(inode);
 
     #else
@@ -156,21 +139,17 @@ struct file *filesys_open (const char *name) {
 bool
 filesys_remove (const char *name) {
 	#ifdef EFILESYS
-	const char *cp_name = (char *)malloc(strlen(name) + 1); // 생성하고자 하는 파일의 경로
-	strlcpy(cp_name, name, strlen(name) + 1);
-
-	const char *file_name = (char *)malloc(strlen(name) + 1); // 생성하고자 하는 파일의 이름
-	struct dir *dir = parse_path(cp_name, file_name);
+	char file_name[NAME_MAX + 1]; // 지우고자 하는 파일의 이름
+	struct dir *dir = parse_path(name, file_name);
 
 	struct inode *inode = NULL;
 	bool success = false;
 
-	if(dir != NULL){
-		dir_lookup(dir, file_name, &inode);
+	if(dir != NULL && dir_lookup(dir, file_name, &inode)){
 
 		if(inode_is_dir(inode)){
 			struct dir *cur_dir = dir_open(inode);
-			char *tmp = (char *)malloc(NAME_MAX + 1);
+			char tmp[NAME_MAX + 1];
 			dir_seek(cur_dir, 2 * sizeof(struct dir_entry));
 
 			if(!dir_readdir(cur_dir, tmp)){
@@ -181,7 +160,6 @@ filesys_remove (const char *name) {
 				success = dir_remove(cur_dir, file_name);
 			}
 			dir_close(cur_dir);
-			free(tmp);
 		}
 		else{
 			inode_close(inode);
@@ -189,8 +167,6 @@ filesys_remove (const char *name) {
 		}
 	}
 	dir_close(dir);
-	free(cp_name);
-	free(file_name);
 
 	return success;
 
@@ -211,12 +187,12 @@ do_format (void) {
 #ifdef EFILESYS
 	/* Create FAT and save it to the disk. */
 	fat_create ();
-	if (!dir_create (ROOT_DIR_SECTOR, 16)){
+	if (!dir_create (ROOT_DIR_CLUSTER, 16)){
 		PANIC ("root directory creation failed");
 	}
 	struct dir *root_dir = dir_open_root();
-	dir_add(root_dir, ".", ROOT_DIR_SECTOR);
-	dir_add(root_dir, "..", ROOT_DIR_SECTOR);
+	dir_add(root_dir, ".", ROOT_DIR_CLUSTER);
+	dir_add(root_dir, "..", ROOT_DIR_CLUSTER);
 	dir_close(root_dir);
 	
 	fat_close ();
@@ -235,17 +211,13 @@ bool filesys_create_dir(const char* name) {
 
     bool success = false;
 
-    // name의 파일경로를 cp_name에복사
-    char* cp_name = (char *)malloc(strlen(name) + 1);
-    strlcpy(cp_name, name, strlen(name) + 1);
-
     // name 경로분석
-    char* file_name = (char *)malloc(strlen(name) + 1);
-    struct dir* dir = parse_path(cp_name, file_name);
+    char file_name[NAME_MAX + 1];
+    struct dir* dir = parse_path(name, file_name);
 
 
-    // bitmap에서 inode sector 번호 할당
-    cluster_t inode_cluster = fat_create_chain(0);
+    // FAT에서 inode cluster 번호 할당
+    cluster_t inode_cluster = dir != NULL ? fat_create_chain(0) : 0;
     struct inode *sub_dir_inode;
     struct dir *sub_dir = NULL;
 
@@ -254,7 +226,7 @@ bool filesys_create_dir(const char* name) {
 	   디렉터리 엔트리에 file_name의 엔트리 추가
        디렉터리 엔트리에 ‘.’, ‘..’ 파일의 엔트리 추가 */
     success = (		// ".", ".." 추가
-                dir != NULL
+            	inode_cluster != 0
             	&& dir_create(inode_cluster, 16)
             	&& dir_add(dir, file_name, inode_cluster)
             	&& dir_lookup(dir, file_name, &sub_dir_inode)
@@ -269,94 +241,86 @@ bool filesys_create_dir(const char* name) {
     dir_close(sub_dir);
     dir_close(dir);
 
-    free(cp_name);
-    free(file_name);
     return success;
 }
 
 
-// 경로 분석 함수 구현
-struct dir *parse_path(char *path_name, char *file_name) {  // file_name: path_name을 분석하여 파일, 디렉터리의 이름을 포인팅
-    struct dir *dir = NULL;
-    if (path_name == NULL || file_name == NULL)
-        return NULL;
-    if (strlen(path_name) == 0)
-        return NULL;
-
-    // path_name의 절대/상대 경로에 따른 디렉터리 정보 저장
-    if(path_name[0] == '/') {
-        dir = dir_open_root();
-    }
-    else {
-        dir = dir_reopen(thread_current()->cur_dir);
+/* Extracts a file name part from *SRCP into PART, and updates *SRCP so
+ * that the next call will return the next file name part.  Returns 1 if
+ * successful, 0 at end of string, -1 for a too-long file name part. */
+static int
+get_next_part (char part[NAME_MAX + 1], const char **srcp) {
+	const char *src = *srcp;
+	char *dst = part;
+
+	/* Skip leading slashes.  If it's all slashes, we're done. */
+	while (*src == '/')
+		src++;
+	if (*src == '\0')
+		return 0;
+
+	/* Copy up to NAME_MAX character from SRC to DST.  Add null
+	 * terminator. */
+	while (*src != '/' && *src != '\0') {
+		if (dst < part + NAME_MAX)
+			*dst++ = *src;
+		else
+			return -1;
+		src++;
 	}
+	*dst = '\0';
 
-    char *token, *nextToken, *savePtr;
-    token = strtok_r(path_name, "/", &savePtr);
-    nextToken = strtok_r(NULL, "/", &savePtr);
-
-    // "/"를 open하려는 케이스
-    if(token == NULL) {
-        token = (char*)malloc(2);
-        strlcpy(token, ".", 2);
-    }
-
-    struct inode *inode;
-    while (token != NULL && nextToken != NULL) {
-        // dir에서 token이름의 파일을 검색하여 inode의 정보를 저장
-        if (!dir_lookup(dir, token, &inode)) {
-            dir_close(dir);
-            return NULL;
-        }
-
-        // if(inode->data.is_link) {   // 링크 파일인 경우
-
-        //     char* new_path = (char*)malloc(sizeof(strlen(inode->data.link_name)) + 1);
-        //     strlcpy(new_path, inode->data.link_name, strlen(inode->data.link_name) + 1);
-
-        //     strlcpy(path_name, new_path, strlen(new_path) + 1);
-        //     free(new_path);
- 
-        //     strlcat(path_name, "/", strlen(path_name) + 2);
-        //     strlcat(path_name, nextToken, strlen(path_name) + strlen(nextToken) + 1);
-        //     strlcat(path_name, savePtr, strlen(path_name) + strlen(savePtr) + 1);
-
-        //     dir_close(dir);
-
-        //     // 파싱된 경로로 다시 시작한다
-        //     if(path_name[0] == '/') {
-        //         dir = dir_open_root();
-        //     }
-        //     else {
-        //         dir = dir_reopen(thread_current()->cur_dir);
-        //     }
+	/* Advance source pointer. */
+	*srcp = src;
+	return 1;
+}
 
+// 경로 분석 함수 구현
+/* Opens the directory that holds the last part of PATH_NAME, and copies
+ * that part into FILE_NAME: "." if PATH_NAME is "/".  Returns a null
+ * pointer if a directory on the way does not exist, or a part is longer
+ * than NAME_MAX.  Directories on the way are looked up through the
+ * dentry cache by inode number, without opening them, so a path walked
+ * before costs no disk access and no allocation until the last
+ * directory is opened. */
+struct dir *parse_path(const char *path_name, char file_name[NAME_MAX + 1]) {
+    char next[NAME_MAX + 1];
+    disk_sector_t cur;
+
+    if (path_name == NULL || file_name == NULL || *path_name == '\0')
+        return NULL;
 
-        //     token = strtok_r(path_name, "/", &savePtr);
-        //     nextToken = strtok_r(NULL, "/", &savePtr);
+    // path_name의 절대/상대 경로에 따른 시작 디렉터리
+    if (path_name[0] == '/')
+        cur = ROOT_DIR_CLUSTER;
+    else
+        cur = inode_get_inumber(dir_get_inode(thread_current()->cur_dir));
 
-        //     continue;
-        // }
-        
-        // inode가 파일일 경우 NULL 반환
-        if(!inode_is_dir(inode)) {
-            dir_close(dir);
-            inode_close(inode);
-            return NULL;
+    switch (get_next_part(file_name, &path_name)) {
+    case -1:
+        return NULL;
+    case 0:
+        // "/"를 open하려는 케이스
+        strlcpy(file_name, ".", NAME_MAX + 1);
+        break;
+    default:
+        for (;;) {
+            int result = get_next_part(next, &path_name);
+            if (result < 0)
+                return NULL;
+            if (result == 0)
+                break;
+
+            // file_name은 경로 중간의 디렉터리여야 한다.
+            disk_sector_t inumber;
+            bool is_dir;
+            if (!dir_resolve(cur, file_name, &inumber, &is_dir) || !is_dir)
+                return NULL;
+            cur = inumber;
+            strlcpy(file_name, next, NAME_MAX + 1);
         }
-        // dir의 디렉터리 정보를 메모리에서 해지
-        dir_close(dir);
-
-        // inode의 디렉터리 정보를 dir에 저장
-        dir = dir_open(inode);
-
-        // token에 검색할 경로이름 저장
-        token = nextToken;
-        nextToken = strtok_r(NULL, "/", &savePtr);
     }
-    // token의 파일이름을 file_name에 저장
-    strlcpy (file_name, token, strlen(token) + 1);
 
     // dir정보반환
-    return dir;
-}
\ No newline at end of file
+    return dir_open(inode_open(cur));
+}
@@ -4,8 +4,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include "filesys/directory.h"
+#include "filesys/fat.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "devices/disk.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
@@ -26,6 +28,46 @@ fsutil_ls (char **argv UNUSED) {
 	printf ("End of listing.\n");
 }
 
+/* Prints how fragmented the files in the root directory are: the number
+ * of runs of consecutive clusters each one is in, and the average length
+ * of a run over all of them. */
+void
+fsutil_frag (char **argv UNUSED) {
+	struct dir *dir;
+	char name[NAME_MAX + 1];
+	size_t total_clusters = 0, total_runs = 0;
+
+	printf ("Fragmentation of the root directory:\n");
+	dir = dir_open_root ();
+	if (dir == NULL)
+		PANIC ("root dir open failed");
+	while (dir_readdir (dir, name)) {
+		struct inode *inode;
+		size_t clusters, runs;
+
+		if (!strcmp (name, ".") || !strcmp (name, "..")
+				|| !dir_lookup (dir, name, &inode))
+			continue;
+		if (inode_is_inline (inode)) {
+			inode_close (inode);
+			printf ("%s: inline\n", name);
+			continue;
+		}
+		runs = fat_chain_runs (sector_to_cluster (inode->data.start), &clusters);
+		inode_close (inode);
+		printf ("%s: %zu clusters in %zu runs\n", name, clusters, runs);
+		total_clusters += clusters;
+		total_runs += runs;
+	}
+	dir_close (dir);
+
+	if (total_runs > 0) {
+		size_t avg = total_clusters * 100 / total_runs;
+		printf ("Average run length: %zu.%02zu clusters\n", avg / 100, avg % 100);
+	}
+	printf ("End of report.\n");
+}
+
 /* Prints the contents of file ARGV[1] to the system console as
  * hex and ASCII. */
 void
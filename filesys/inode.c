@@ -1,15 +1,20 @@
 #include "filesys/inode.h"
 #include <list.h>
 #include <debug.h>
+#include <hash.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
 #include "filesys/fat.h"
+#include "filesys/page_cache.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
+
+/* Most clusters preallocated past the end of a growing file. */
+#define PREALLOC_MAX 64
 #define EFILESYS
 
 /* On-disk inode.
@@ -32,6 +37,17 @@ bytes_to_sectors (off_t size) {
 	return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 }
 
+#ifdef EFILESYS
+/* Returns the number of clusters in the chain of an inode SIZE bytes
+ * long.  Even an empty file has its first cluster. */
+static inline size_t
+bytes_to_clusters (off_t size) {
+	size_t clusters = DIV_ROUND_UP (bytes_to_sectors (size),
+			fat_cluster_sectors ());
+	return clusters > 0 ? clusters : 1;
+}
+#endif
+
 /* In-memory inode. */
 // struct inode {
 // 	struct list_elem elem;              /* Element in inode list. */
@@ -42,22 +58,140 @@ bytes_to_sectors (off_t size) {
 // 	struct inode_disk data;             /* Inode content. */
 // };
 
+/* Returns the disk sector of sector IDX of INODE, which is mapped.
+ * Caller holds extent_lock. */
+static disk_sector_t
+extent_lookup (const struct inode *inode, uint32_t idx) {
+	size_t lo = 0, hi = inode->extent_cnt;
+
+	ASSERT (idx < inode->mapped);
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+		if (inode->extents[mid].idx <= idx)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return inode->extents[lo].sector + (idx - inode->extents[lo].idx);
+}
+
+/* Maps the CNT sectors from SECTOR as the next sectors of INODE.
+ * Returns false if memory runs out.  Caller holds extent_lock. */
+static bool
+extent_append (struct inode *inode, disk_sector_t sector, uint32_t cnt) {
+	struct inode_extent *last = inode->extent_cnt > 0
+		? &inode->extents[inode->extent_cnt - 1] : NULL;
+
+	if (last != NULL && last->sector + last->len == sector) {
+		last->len += cnt;
+		inode->mapped += cnt;
+		return true;
+	}
+	if (inode->extent_cnt == inode->extent_cap) {
+		size_t cap = inode->extent_cap ? inode->extent_cap * 2 : 4;
+		struct inode_extent *extents = realloc (inode->extents,
+				cap * sizeof *extents);
+		if (extents == NULL)
+			return false;
+		inode->extents = extents;
+		inode->extent_cap = cap;
+	}
+	inode->extents[inode->extent_cnt++] = (struct inode_extent) {
+		.idx = inode->mapped,
+		.sector = sector,
+		.len = cnt,
+	};
+	inode->mapped += cnt;
+	return true;
+}
+
+/* Follows INODE's FAT chain from the last mapped cluster up to the one
+ * with sector IDX, mapping the clusters on the way, and returns IDX's
+ * disk sector.  Returns -1 if the chain ends first.
+ * Caller holds extent_lock. */
+static disk_sector_t
+extent_extend (struct inode *inode, uint32_t idx) {
+	uint32_t spc = fat_cluster_sectors ();
+	cluster_t clst;
+	uint32_t n;
+
+	/* Whole clusters are mapped, so the map ends at a cluster's end. */
+	if (inode->mapped == 0)
+		clst = sector_to_cluster (inode->data.start);
+	else {
+		struct inode_extent *last = &inode->extents[inode->extent_cnt - 1];
+		clst = fat_get (sector_to_cluster (last->sector + last->len - 1));
+	}
+
+	for (n = inode->mapped; ; n += spc) {
+		if (clst == 0 || clst == EOChain)
+			return -1;
+		disk_sector_t sector = cluster_to_sector (clst);
+		bool mapped = extent_append (inode, sector, spc);
+		if (idx < n + spc)
+			return sector + (idx - n);
+		if (!mapped)
+			break;
+		clst = fat_get (clst);
+	}
+
+	/* Out of memory: walk the rest of the chain without mapping it. */
+	for (; idx >= n + spc; n += spc) {
+		clst = fat_get (clst);
+		if (clst == 0 || clst == EOChain)
+			return -1;
+	}
+	return cluster_to_sector (clst) + (idx - n);
+}
+
+/* Forgets where the sectors of INODE from index CNT on are, after the
+ * file is cut to CNT sectors.  CNT of 0 frees the map. */
+static void
+extent_truncate (struct inode *inode, uint32_t cnt) {
+	lock_acquire (&inode->extent_lock);
+	while (inode->extent_cnt > 0
+			&& inode->extents[inode->extent_cnt - 1].idx >= cnt)
+		inode->extent_cnt--;
+	if (inode->extent_cnt > 0) {
+		struct inode_extent *last = &inode->extents[inode->extent_cnt - 1];
+		if (last->idx + last->len > cnt)
+			last->len = cnt - last->idx;
+	}
+	if (inode->mapped > cnt)
+		inode->mapped = cnt;
+	if (inode->extent_cnt == 0) {
+		free (inode->extents);
+		inode->extents = NULL;
+		inode->extent_cap = 0;
+	}
+	lock_release (&inode->extent_lock);
+}
+
+/* Returns the disk sector of sector IDX of INODE's chain, or -1 if the
+ * chain is shorter. */
+static disk_sector_t
+sector_at (struct inode *inode, uint32_t idx) {
+	disk_sector_t sector;
+
+	lock_acquire (&inode->extent_lock);
+	if (idx < inode->mapped)
+		sector = extent_lookup (inode, idx);
+	else
+		sector = extent_extend (inode, idx);
+	lock_release (&inode->extent_lock);
+	return sector;
+}
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
  * POS. */
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) {
+byte_to_sector (struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
 	if (pos < inode->data.length){
 		#ifdef EFILESYS
-			cluster_t clst = sector_to_cluster(inode->data.start);
-			for (unsigned i = 0; i< (pos/DISK_SECTOR_SIZE); i++){
-				clst = fat_get(clst);
-				if(clst == 0)
-					return -1;
-			}
-			return cluster_to_sector(clst);
+			return sector_at (inode, pos / DISK_SECTOR_SIZE);
 		#else
 			return	inode->data.start + pos / DISK_SECTOR_SIZE;
 		#endif
@@ -66,14 +200,178 @@ byte_to_sector (const struct inode *inode, off_t pos) {
 		return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Returns true if INODE's data is in its disk inode, not in clusters. */
+bool
+inode_is_inline (const struct inode *inode) {
+	return inode->data.start == 0;
+}
+
+#ifdef EFILESYS
+/* Moves the data of inline INODE out to clusters, so that it can grow
+ * past INODE_INLINE_MAX bytes.  Returns false if the disk is full. */
+static bool
+inode_migrate (struct inode *inode) {
+	uint8_t sector[DISK_SECTOR_SIZE];
+	size_t cnt = bytes_to_clusters (inode->data.length);
+
+	ASSERT (inode_is_inline (inode));
+
+	cluster_t start = fat_create_chain_multiple (0, cnt);
+	if (start == 0)
+		return false;
+
+	/* The data fits in the first sector.  inode_grow() zeros the rest
+	 * as the file grows into it. */
+	memset (sector, 0, sizeof sector);
+	memcpy (sector, inode->data.inline_data, inode->data.length);
+	page_cache_write (cluster_to_sector (start), sector, 0, DISK_SECTOR_SIZE);
+
+	memset (inode->data.inline_data, 0, sizeof inode->data.inline_data);
+	inode->data.start = cluster_to_sector (start);
+	inode->alloc_cnt = cnt;
+	inode->dirty = true;
+	return true;
+}
+
+/* Adds CNT clusters to the end of INODE's chain, and SPARE more if the
+ * disk has room for them.  Returns false if it does not have CNT. */
+static bool
+inode_alloc (struct inode *inode, size_t cnt, size_t spare) {
+	uint32_t spc = fat_cluster_sectors ();
+	cluster_t tail = sector_to_cluster (sector_at (inode,
+				inode->alloc_cnt * spc - 1));
+	cluster_t first = 0;
+
+	/* Clusters past the tail were preallocated by a run that ended
+	 * without giving them back, after the FAT reached the disk. */
+	if (fat_get (tail) != EOChain)
+		fat_remove_chain (fat_get (tail), tail);
+
+	if (spare > 0)
+		first = fat_create_chain_multiple (tail, cnt + spare);
+	if (first == 0) {
+		spare = 0;
+		first = fat_create_chain_multiple (tail, cnt);
+	}
+	if (first == 0)
+		return false;
+
+	/* Map the new clusters while their numbers are at hand. */
+	lock_acquire (&inode->extent_lock);
+	if (inode->mapped == inode->alloc_cnt * spc) {
+		cluster_t clst = first;
+		while (clst != EOChain
+				&& extent_append (inode, cluster_to_sector (clst), spc))
+			clst = fat_get (clst);
+	}
+	lock_release (&inode->extent_lock);
+
+	inode->alloc_cnt += cnt + spare;
+	return true;
+}
+
+/* Extends INODE with zeros to LENGTH bytes.  If SPECULATE, a file that
+ * needs new clusters gets as many again as it has, up to PREALLOC_MAX,
+ * past its end, so that the next appends find them in place and in a
+ * row.  They are given back when the inode is closed, or when the file
+ * system shuts down with the inode open.
+ * Returns false if the disk is full. */
+static bool
+inode_grow (struct inode *inode, off_t length, bool speculate) {
+	static char zeros[DISK_SECTOR_SIZE];
+	off_t old = inode->data.length;
+	size_t need = bytes_to_clusters (length);
+
+	ASSERT (length > old);
+	if (need > inode->alloc_cnt) {
+		size_t spare = 0;
+		if (speculate)
+			spare = inode->alloc_cnt < PREALLOC_MAX
+				? inode->alloc_cnt : PREALLOC_MAX;
+		if (!inode_alloc (inode, need - inode->alloc_cnt, spare))
+			return false;
+	}
+
+	inode->data.length = length;
+	for (off_t pos = old; pos < length;
+			pos = ROUND_DOWN (pos, DISK_SECTOR_SIZE) + DISK_SECTOR_SIZE) {
+		int ofs = pos % DISK_SECTOR_SIZE;
+		page_cache_write (byte_to_sector (inode, pos), zeros, ofs,
+				DISK_SECTOR_SIZE - ofs);
+	}
+	return true;
+}
+#endif
+
+/* Number of hash chains of inodes in memory, a power of 2. */
+#define INODE_BUCKETS 64
+
+/* Most closed inodes kept in memory. */
+#define INODE_WARM_MAX 32
+
+/* Inodes in memory, open or warm, hashed by inode number, so that
+ * opening a single inode twice returns the same `struct inode'. */
+static struct list inode_buckets[INODE_BUCKETS];
+
+/* Closed inodes kept in memory, most recently closed first, so that
+ * reopening a file that was used lately reads nothing from disk. */
+static struct list warm_inodes;
+static size_t warm_cnt;
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	for (size_t i = 0; i < INODE_BUCKETS; i++)
+		list_init (&inode_buckets[i]);
+	list_init (&warm_inodes);
+}
+
+static struct list *
+inode_bucket (disk_sector_t sector) {
+	return &inode_buckets[hash_int (sector) & (INODE_BUCKETS - 1)];
+}
+
+/* Returns the inode in memory for SECTOR, or a null pointer. */
+static struct inode *
+inode_find (disk_sector_t sector) {
+	struct list *bucket = inode_bucket (sector);
+
+	for (struct list_elem *e = list_begin (bucket); e != list_end (bucket);
+			e = list_next (e)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+		if (inode->sector == sector)
+			return inode;
+	}
+	return NULL;
+}
+
+/* Writes INODE's metadata to its sector, through the buffer cache, if
+ * it changed since it was last written. */
+static void
+inode_write_back (struct inode *inode) {
+	if (inode->dirty) {
+		page_cache_write (cluster_to_sector (inode->sector), &inode->data, 0,
+				DISK_SECTOR_SIZE);
+		inode->dirty = false;
+	}
+}
+
+/* Forgets INODE, which nobody has open, and frees it. */
+static void
+inode_free (struct inode *inode) {
+	ASSERT (inode->open_cnt == 0);
+
+	list_remove (&inode->elem);
+	extent_truncate (inode, 0);
+	free (inode);
+}
+
+/* Forgets warm INODE. */
+static void
+inode_cool (struct inode *inode) {
+	list_remove (&inode->lru_elem);
+	warm_cnt--;
+	inode_free (inode);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -91,6 +389,13 @@ inode_create (disk_sector_t sector, off_t length, uint32_t is_dir) {
 	 * one sector in size, and you should fix that. */
 	ASSERT (sizeof *disk_inode == DISK_SECTOR_SIZE);
 
+	/* SECTOR may have held an inode that is still warm. */
+	struct inode *old = inode_find (sector);
+	if (old != NULL) {
+		ASSERT (old->open_cnt == 0);
+		inode_cool (old);
+	}
+
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
 		size_t sectors = bytes_to_sectors (length);
@@ -98,38 +403,48 @@ inode_create (disk_sector_t sector, off_t length, uint32_t is_dir) {
 		disk_inode->magic = INODE_MAGIC;
 		#ifdef EFILESYS
 		disk_inode->is_dir = is_dir;
-		
-		cluster_t clst = sector_to_cluster(sector); 
-		
 
-		disk_inode->start = cluster_to_sector(fat_create_chain(0));
-
-		cluster_t newclst = sector_to_cluster(disk_inode->start);
+		/* A small file lives in its inode until it grows out of it.  The
+		 * rest of INLINE_DATA is zeros, as calloc() left it. */
+		if (length <= INODE_INLINE_MAX) {
+			page_cache_write (cluster_to_sector (sector), disk_inode, 0,
+					DISK_SECTOR_SIZE);
+			free (disk_inode);
+			return true;
+		}
 
-		for (int i = 1; i < sectors; i++){
-			newclst = fat_create_chain(newclst);
-			//printf("newclst = %d \n",newclst);
+		/* All clusters at once, in a row if possible. */
+		cluster_t start = fat_create_chain_multiple (0, bytes_to_clusters (length));
+		if (start == 0) {
+			/* Disk full. */
+			free (disk_inode);
+			return false;
 		}
-		disk_write (filesys_disk, sector, disk_inode);
-		newclst = sector_to_cluster(disk_inode->start);
+		disk_inode->start = cluster_to_sector (start);
+
+		page_cache_write (cluster_to_sector (sector), disk_inode, 0,
+				DISK_SECTOR_SIZE);
+		cluster_t newclst = start;
 		if (sectors > 0) {
 			static char zeros[DISK_SECTOR_SIZE];
-			for (int i = 0; i < sectors; i++){
-				disk_write (filesys_disk, cluster_to_sector(newclst), zeros); // non-contiguous sectors 
-				newclst = fat_get(newclst); // find next cluster(=sector) in FAT
-				//printf("clst = %d\n",clst);
+			uint32_t spc = fat_cluster_sectors ();
+			for (size_t i = 0; i < sectors; i++){
+				page_cache_write (cluster_to_sector(newclst) + i % spc, zeros, 0, DISK_SECTOR_SIZE); // non-contiguous clusters
+				if (i % spc == spc - 1)
+					newclst = fat_get(newclst); // find next cluster in FAT
 			}
 		}
 		success = true;
 		#else
 		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
+			page_cache_write (sector, disk_inode, 0, DISK_SECTOR_SIZE);
 			if (sectors > 0) {
 				static char zeros[DISK_SECTOR_SIZE];
 				size_t i;
 
 				for (i = 0; i < sectors; i++)
-					disk_write (filesys_disk, disk_inode->start + i, zeros);
+					page_cache_write (disk_inode->start + i, zeros, 0,
+							DISK_SECTOR_SIZE);
 			}
 			success = true; 
 		} 
@@ -143,17 +458,17 @@ inode_create (disk_sector_t sector, off_t length, uint32_t is_dir) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
 	struct inode *inode;
 
-	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
+	/* Check whether this inode is already open, or still warm. */
+	inode = inode_find (sector);
+	if (inode != NULL) {
+		if (inode->open_cnt == 0) {
+			list_remove (&inode->lru_elem);
+			warm_cnt--;
 		}
+		inode_reopen (inode);
+		return inode;
 	}
 
 	/* Allocate memory. */
@@ -162,13 +477,25 @@ inode_open (disk_sector_t sector) {
 		return NULL;
 
 	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	list_push_front (inode_bucket (sector), &inode->elem);
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-
-	disk_read (filesys_disk, cluster_to_sector(inode->sector), &inode->data);
+	inode->dirty = false;
+	inode->ra_pos = 0;
+	lock_init (&inode->extent_lock);
+	inode->extents = NULL;
+	inode->extent_cnt = 0;
+	inode->extent_cap = 0;
+	inode->mapped = 0;
+
+	page_cache_read (cluster_to_sector(inode->sector), &inode->data, 0,
+			DISK_SECTOR_SIZE);
+	#ifdef EFILESYS
+	inode->alloc_cnt = inode_is_inline (inode)
+		? 0 : bytes_to_clusters (inode->data.length);
+	#endif
 	return inode;
 }
 
@@ -186,9 +513,24 @@ inode_get_inumber (const struct inode *inode) {
 	return inode->sector;
 }
 
-/* Closes INODE and writes it to disk.
- * If this was the last reference to INODE, frees its memory.
- * If INODE was also a removed inode, frees its blocks. */
+/* Gives back the clusters preallocated past the end of INODE. */
+static void
+inode_trim (struct inode *inode) {
+	uint32_t keep = bytes_to_clusters (inode->data.length);
+	if (inode->alloc_cnt > keep) {
+		uint32_t spc = fat_cluster_sectors ();
+		cluster_t last = sector_to_cluster (sector_at (inode,
+					keep * spc - 1));
+		fat_remove_chain (fat_get (last), last);
+		inode->alloc_cnt = keep;
+		extent_truncate (inode, keep * spc);
+	}
+}
+
+/* Closes INODE.
+ * If this was the last reference to INODE, writes its changed metadata
+ * back and keeps it warm, in memory, for a while.
+ * If INODE was also a removed inode, frees it and its blocks. */
 void
 inode_close (struct inode *inode) {
 	/* Ignore null pointer. */
@@ -197,17 +539,48 @@ inode_close (struct inode *inode) {
 
 	/* Release resources if this was the last opener. */
 	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
-
-
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
-			fat_remove_chain (sector_to_cluster(inode->sector), 0);
-			fat_remove_chain (sector_to_cluster(inode->data.start),0); 
+			/* A directory's index goes with it. */
+			if (inode->data.dir_index != 0) {
+				struct inode *index = inode_open (inode->data.dir_index);
+				if (index != NULL) {
+					inode_remove (index);
+					inode_close (index);
+				}
+			}
+			fat_remove_chain (inode->sector, 0);
+			if (!inode_is_inline (inode))
+				fat_remove_chain (sector_to_cluster(inode->data.start),0); 
+			inode_free (inode);
+			return;
 		}
 
-		free (inode); 
+		inode_trim (inode);
+		inode_write_back (inode);
+
+		list_push_front (&warm_inodes, &inode->lru_elem);
+		if (++warm_cnt > INODE_WARM_MAX)
+			inode_cool (list_entry (list_back (&warm_inodes), struct inode,
+						lru_elem));
+	}
+}
+
+/* Gives back the preallocated clusters and writes back the changed
+ * metadata of every inode in memory.  Called when the file system shuts
+ * down, with files still open. */
+void
+inode_done (void) {
+	for (size_t i = 0; i < INODE_BUCKETS; i++) {
+		struct list *bucket = &inode_buckets[i];
+		for (struct list_elem *e = list_begin (bucket);
+				e != list_end (bucket); e = list_next (e)) {
+			struct inode *inode = list_entry (e, struct inode, elem);
+			if (!inode->removed) {
+				inode_trim (inode);
+				inode_write_back (inode);
+			}
+		}
 	}
 }
 
@@ -226,7 +599,17 @@ off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
+	bool sequential = offset == inode->ra_pos;
+
+	/* Inline data was read in with the inode. */
+	if (inode_is_inline (inode)) {
+		if (offset >= inode_length (inode))
+			return 0;
+		if (size > inode_length (inode) - offset)
+			size = inode_length (inode) - offset;
+		memcpy (buffer, inode->data.inline_data + offset, size);
+		return size;
+	}
 
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
@@ -243,27 +626,23 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		page_cache_read (sector_idx, buffer + bytes_read, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free (bounce);
+
+	/* A reader that continues where it stopped will want the next
+	 * sector soon: start reading it now. */
+	if (sequential && bytes_read > 0 && offset < inode_length (inode)) {
+		off_t next = ROUND_UP (offset, DISK_SECTOR_SIZE);
+		if (next < inode_length (inode))
+			page_cache_readahead (byte_to_sector (inode, next));
+	}
+	inode->ra_pos = offset;
 
 	return bytes_read;
 }
@@ -330,65 +709,39 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
 	
 	bool grow = false; // 이 파일이 extend할 파일인지 아닌지를 나타내는 flag 
-	uint8_t zero[DISK_SECTOR_SIZE]; // buffer for zero padding
 	
     /* 해당 파일이 write 작업을 허용하지 않으면 0을 리턴*/
 	if (inode->deny_write_cnt)
 		return 0;
 
-	/* inode의 데이터 영역에 충분한 공간이 있는지를 체크한다.
-    write가 끝나는 지점인 offset+size까지 공간이 있는지를 체크한다. 
-    공간이 없다면 -1을 리턴한다.
-    */
-	disk_sector_t sector_idx = byte_to_sector (inode, offset + size);
-
 	// Project 4-1 : File growth
-    /* 디스크에 충분한 공간이 없다면 파일을 늘린다(extend).
-    확장할 때 EOF부터 write를 끝내는 지점까지의 모든 데이터를 0으로 초기화(memset)한다.*/
+    /* write가 끝나는 지점(offset+size)이 파일 끝을 넘으면 파일을 먼저 늘린다(extend).
+    늘어난 부분은 inode_grow()가 0으로 채운다. 디스크가 가득 차면 파일 안쪽만 쓴다. */
 	#ifdef EFILESYS
-	while (sector_idx == -1){
-		grow = true; // flag 체크: 파일이 커진다는 것을 표시
-		off_t inode_len = inode_length(inode); // 해당 inode 데이터 길이
-		
-		// endclst: 파일 데이터 영역의 가장 끝 섹터 번호를 불러온다.
-		cluster_t endclst = sector_to_cluster(byte_to_sector(inode, inode_len - 1));
-		// endclst 뒤에 새 클러스터를 만든다.
-        cluster_t newclst = inode_len == 0 ? endclst : fat_create_chain(endclst);
-		if (newclst == 0){
-			break; //newclst가 0이면 여분 공간이 없다는 뜻.
+	/* 작은 파일은 inode 안에 쓴다. 넘치면 cluster로 옮긴다.
+	 * 옮길 수 없으면 inode에 들어가는 만큼만 쓴다. */
+	if (inode_is_inline (inode)) {
+		if (offset + size > INODE_INLINE_MAX && !inode_migrate (inode)) {
+			if (offset >= INODE_INLINE_MAX)
+				return 0;
+			size = INODE_INLINE_MAX - offset;
 		}
-
-		// Zero padding
-		memset (zero, 0, DISK_SECTOR_SIZE);
-
-		off_t inode_ofs = inode_len % DISK_SECTOR_SIZE;
-		if(inode_ofs != 0)
-			inode->data.length += DISK_SECTOR_SIZE - inode_ofs; // round up to DISK_SECTOR_SIZE for convinience
-		// #ifdef Q. What if inode_ofs == 0? Unnecessary sector added -> unnecessary가 아님. extend 중이니까! 
-
-		disk_write (filesys_disk, cluster_to_sector(newclst), zero); // zero padding for new cluster
-		if (inode_ofs != 0){
-			disk_read (filesys_disk, cluster_to_sector(endclst), zero);
-			memset (zero + inode_ofs + 1 , 0, DISK_SECTOR_SIZE - inode_ofs);
-			disk_write (filesys_disk, cluster_to_sector(endclst), zero); // zero padding for current cluster
-			/*
-					endclst          newclst (extended)
-				 ---------------     ------------
-				| data  0 0 0 0 | - | 0 0 0 0 0 |
-				 ---------------     -----------
-						↑ zero padding here!
-			*/
+		if (inode_is_inline (inode)) {
+			memcpy (inode->data.inline_data + offset, buffer, size);
+			if (offset + size > inode_length (inode))
+				inode->data.length = offset + size;
+			inode->dirty = true;
+			return size;
 		}
+	}
 
-		inode->data.length += DISK_SECTOR_SIZE; // update file length
-		sector_idx = byte_to_sector (inode, offset + size);
-	}		
+	if (offset + size > inode_length (inode))
+		grow = inode_grow (inode, offset + size, true);
 	#endif
 
-	sector_idx = byte_to_sector (inode, offset); // start writing from offset
+	disk_sector_t sector_idx = byte_to_sector (inode, offset); // start writing from offset
 
 	while (size > 0) {
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
@@ -403,39 +756,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-
-			#ifdef EFILESYS
-				// if (grow == true && size - chunk_size == 0) // last chunk
-				// 	memset (bounce + sector_ofs + chunk_size + 1, 'EOF', 1);
-
-				// #ifdef DBG
-				/*
-				inode_write_at에서, extend한 맨 마지막 chunk에 EOF 표시를 해줄 필요가 있나? 
-				그리고 'EOF'는 character가 아니라 memset엔 못쓸텐데, 고쳐야 하는거 맞지?
-				*/
-			#endif
-			
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+		/* The cache reads in the rest of a partly written sector. */
+		page_cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
@@ -444,18 +767,87 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 	
 		sector_idx = byte_to_sector (inode, offset);
 	}
+	// 길이가 바뀌었으면 inode는 close나 sync 때 쓴다.
+	if (grow)
+		inode->dirty = true;
+
+	return bytes_written;
+}
+
+/* Writes INODE's cached data, the FAT and INODE itself to disk, in that
+ * order, so that the inode on disk never refers to clusters that the
+ * FAT on disk does not give it. */
+void
+inode_sync (struct inode *inode) {
 	#ifdef EFILESYS
-		if (grow == true){
-			inode->data.length = offset; // correct inode length
+	bool mapped_all;
+
+	if (inode_is_inline (inode)) {
+		inode_write_back (inode);
+		page_cache_flush (cluster_to_sector (inode->sector), 1);
+		return;
+	}
+
+	/* Map the whole chain, then write back each run of it at once. */
+	sector_at (inode, inode->alloc_cnt * fat_cluster_sectors () - 1);
+	lock_acquire (&inode->extent_lock);
+	mapped_all = inode->mapped >= inode->alloc_cnt * fat_cluster_sectors ();
+	if (mapped_all)
+		for (size_t i = 0; i < inode->extent_cnt; i++)
+			page_cache_flush (inode->extents[i].sector, inode->extents[i].len);
+	lock_release (&inode->extent_lock);
+	if (!mapped_all)
+		page_cache_writeback ();
+
+	fat_writeback ();
+	inode_write_back (inode);
+	page_cache_flush (cluster_to_sector (inode->sector), 1);
+	#else
+	page_cache_writeback ();
+	#endif
+}
+
+/* Makes sure INODE has disk space for its first LENGTH bytes, extending
+ * it with zeros if it is shorter.  Returns false if the disk is full or
+ * writes to INODE are denied. */
+bool
+inode_allocate (struct inode *inode, off_t length) {
+	if (inode->deny_write_cnt)
+		return false;
+	if (length <= inode_length (inode))
+		return true;
+	#ifdef EFILESYS
+	if (inode_is_inline (inode)) {
+		/* Bytes past the end of inline data are zeros already. */
+		if (length <= INODE_INLINE_MAX) {
+			inode->data.length = length;
+			inode->dirty = true;
+			return true;
 		}
-		// #ifdef DBG Q. 이미 위 file growth 할때 inode->data.length 바꾸고 있잖아. 그리고 offset + size가 length?는 아니지 않나
+		if (!inode_migrate (inode))
+			return false;
+	}
+	if (!inode_grow (inode, length, false))
+		return false;
+	inode->dirty = true;
+	return true;
+	#else
+	return false;
 	#endif
-	free (bounce);
-	// free (zero);
+}
 
-	disk_write (filesys_disk, inode->sector, &inode->data); 
+/* Returns the inode number of the hash index of directory INODE, or 0
+ * if it has none. */
+disk_sector_t
+inode_get_dir_index (const struct inode *inode) {
+	return inode->data.dir_index;
+}
 
-	return bytes_written;
+/* Makes INDEX the hash index of directory INODE. */
+void
+inode_set_dir_index (struct inode *inode, disk_sector_t index) {
+	inode->data.dir_index = index;
+	inode->dirty = true;
 }
 
 /* Disables writes to INODE.
@@ -483,13 +875,8 @@ inode_length (const struct inode *inode) {
 	return inode->data.length;
 }
 
+/* Returns true if INODE is a directory. */
 bool inode_is_dir(const struct inode *inode){
-	bool result;
-	struct inode_disk *disk_inode = calloc (1, sizeof *disk_inode);
-	disk_read(filesys_disk, cluster_to_sector(inode->sector), disk_inode);
-
-	result = disk_inode->is_dir;
-	free(disk_inode);
-	return result;
+	return inode->data.is_dir;
 }
 
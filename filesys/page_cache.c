@@ -1,50 +1,288 @@
-/* page_cache.c: Implementation of Page Cache (Buffer Cache). */
-
-#include "vm/vm.h"
-static bool page_cache_readahead (struct page *page, void *kva);
-static bool page_cache_writeback (struct page *page);
-static void page_cache_destroy (struct page *page);
-
-/* DO NOT MODIFY this struct */
-static const struct page_operations page_cache_op = {
-	.swap_in = page_cache_readahead,
-	.swap_out = page_cache_writeback,
-	.destroy = page_cache_destroy,
-	.type = VM_PAGE_CACHE,
+/* page_cache.c: Implementation of Page Cache (Buffer Cache).
+ *
+ * A write-back cache of PAGE_CACHE_SIZE file system sectors, replaced
+ * with the clock algorithm.  Writes only dirty the cached copy: a dirty
+ * sector reaches the disk when it is evicted, when page_cache_flushd
+ * finds it dirty for longer than page_cache_flush_ticks, when its file is
+ * synced, or when the file system is shut down.  page_cache_flushd also
+ * writes back the changed sectors of the FAT.  page_cache_kworkerd reads sectors ahead of
+ * sequential readers in the background. */
+
+#include "filesys/page_cache.h"
+#include <debug.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/fat.h"
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Number of cached sectors. */
+#define PAGE_CACHE_SIZE 64
+
+/* Most read-ahead requests waiting for page_cache_kworkerd. */
+#define READAHEAD_QUEUE 16
+
+/* How often page_cache_flushd looks for old dirty sectors. */
+#define FLUSH_POLL_TICKS (5 * TIMER_FREQ)
+
+struct cache_entry {
+	disk_sector_t sector;
+	bool valid;                 /* Holds SECTOR. */
+	bool dirty;                 /* Newer than the disk. */
+	bool accessed;              /* Clock reference bit. */
+	bool busy;                  /* Being read or written; wait on io_done. */
+	int64_t dirtied;            /* Tick at which it last became dirty. */
+	uint8_t *data;              /* DISK_SECTOR_SIZE bytes. */
 };
 
-tid_t page_cache_workerd;
+static struct cache_entry cache[PAGE_CACHE_SIZE];
+static struct lock cache_lock;      /* Protects the cache and ra_queue. */
+static struct condition io_done;    /* An entry stopped being busy. */
+static size_t clock_hand;
+
+int64_t page_cache_flush_ticks = 30 * TIMER_FREQ;
 
-/* The initializer of file vm */
+/* Sectors to read ahead, oldest first. */
+static disk_sector_t ra_queue[READAHEAD_QUEUE];
+static size_t ra_head, ra_cnt;
+static struct semaphore ra_sema;    /* Up once per queued sector. */
+
+tid_t page_cache_workerd = TID_ERROR;
+
+static void page_cache_kworkerd (void *aux);
+static void page_cache_flushd (void *aux);
+
+/* Initializes the cache.  Called by filesys_init(), before anything
+ * reads the file system. */
+void
+page_cache_init (void) {
+	uint8_t *data = palloc_get_multiple (PAL_ASSERT,
+			PAGE_CACHE_SIZE * DISK_SECTOR_SIZE / PGSIZE);
+
+	lock_init (&cache_lock);
+	cond_init (&io_done);
+	sema_init (&ra_sema, 0);
+	for (size_t i = 0; i < PAGE_CACHE_SIZE; i++) {
+		cache[i].valid = false;
+		cache[i].busy = false;
+		cache[i].data = data + i * DISK_SECTOR_SIZE;
+	}
+}
+
+/* Starts the read-ahead and write-behind daemons. */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+	page_cache_workerd = thread_create ("page_cache_kworkerd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
+	thread_create ("page_cache_flushd", PRI_DEFAULT, page_cache_flushd, NULL);
 }
 
-/* Initialize the page cache */
-bool
-page_cache_initializer (struct page *page, enum vm_type type, void *kva) {
-	/* Set up the handler */
-	page->operations = &page_cache_op;
+/* Returns the entry that holds SECTOR, or NULL.
+ * Caller holds cache_lock. */
+static struct cache_entry *
+cache_find (disk_sector_t sector) {
+	for (size_t i = 0; i < PAGE_CACHE_SIZE; i++)
+		if (cache[i].valid && cache[i].sector == sector)
+			return &cache[i];
+	return NULL;
+}
+
+/* Writes dirty entry E to disk.  Caller holds cache_lock, which is
+ * released during the write. */
+static void
+cache_flush_entry (struct cache_entry *e) {
+	ASSERT (e->dirty && !e->busy);
 
+	e->busy = true;
+	e->dirty = false;
+	lock_release (&cache_lock);
+	disk_write (filesys_disk, e->sector, e->data);
+	lock_acquire (&cache_lock);
+	e->busy = false;
+	cond_broadcast (&io_done, &cache_lock);
 }
 
-/* Utilze the Swap in mechanism to implement readhead */
-static bool
-page_cache_readahead (struct page *page, void *kva) {
+/* Returns an entry that can be reused: a free one, or a clean one the
+ * clock hand passed twice.  A dirty victim is written back first, and
+ * since cache_lock is released meanwhile, NULL is returned so that the
+ * caller looks again.  Caller holds cache_lock. */
+static struct cache_entry *
+cache_evict (void) {
+	for (size_t n = 0; n < 2 * PAGE_CACHE_SIZE; n++) {
+		struct cache_entry *e = &cache[clock_hand];
+		clock_hand = (clock_hand + 1) % PAGE_CACHE_SIZE;
+
+		if (!e->valid)
+			return e;
+		if (e->busy)
+			continue;
+		if (e->accessed) {
+			e->accessed = false;
+			continue;
+		}
+		if (e->dirty) {
+			cache_flush_entry (e);
+			return NULL;
+		}
+		return e;
+	}
+
+	/* Every entry is busy. */
+	cond_wait (&io_done, &cache_lock);
+	return NULL;
 }
 
-/* Utilze the Swap out mechanism to implement writeback */
-static bool
-page_cache_writeback (struct page *page) {
+/* Returns the entry for SECTOR, reading the sector in if it is not
+ * cached and LOAD is true.  Otherwise a new entry's contents are
+ * garbage and the caller overwrites all of them.
+ * Caller holds cache_lock. */
+static struct cache_entry *
+cache_get (disk_sector_t sector, bool load) {
+	for (;;) {
+		struct cache_entry *e = cache_find (sector);
+		if (e != NULL) {
+			if (!e->busy)
+				return e;
+			cond_wait (&io_done, &cache_lock);
+			continue;
+		}
+
+		e = cache_evict ();
+		if (e == NULL)
+			continue;
+		e->sector = sector;
+		e->valid = true;
+		e->dirty = false;
+		e->accessed = false;
+		if (load) {
+			e->busy = true;
+			lock_release (&cache_lock);
+			disk_read (filesys_disk, sector, e->data);
+			lock_acquire (&cache_lock);
+			e->busy = false;
+			cond_broadcast (&io_done, &cache_lock);
+		}
+		return e;
+	}
 }
 
-/* Destory the page_cache. */
+/* Reads SIZE bytes at offset OFS within SECTOR into BUFFER. */
+void
+page_cache_read (disk_sector_t sector, void *buffer, int ofs, int size) {
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	struct cache_entry *e = cache_get (sector, true);
+	memcpy (buffer, e->data + ofs, size);
+	e->accessed = true;
+	lock_release (&cache_lock);
+}
+
+/* Writes SIZE bytes from BUFFER at offset OFS within SECTOR.  The rest
+ * of the sector is read in first unless the whole of it is written. */
+void
+page_cache_write (disk_sector_t sector, const void *buffer, int ofs,
+		int size) {
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	struct cache_entry *e = cache_get (sector, size < DISK_SECTOR_SIZE);
+	memcpy (e->data + ofs, buffer, size);
+	e->accessed = true;
+	if (!e->dirty) {
+		e->dirty = true;
+		e->dirtied = timer_ticks ();
+	}
+	lock_release (&cache_lock);
+}
+
+/* Asks page_cache_kworkerd to read SECTOR in, if it is not cached.
+ * Returns at once.  The request is dropped if too many are waiting. */
+void
+page_cache_readahead (disk_sector_t sector) {
+	bool queued = false;
+
+	if (page_cache_workerd == TID_ERROR)
+		return;
+
+	lock_acquire (&cache_lock);
+	if (ra_cnt < READAHEAD_QUEUE && cache_find (sector) == NULL) {
+		ra_queue[(ra_head + ra_cnt++) % READAHEAD_QUEUE] = sector;
+		queued = true;
+	}
+	lock_release (&cache_lock);
+	if (queued)
+		sema_up (&ra_sema);
+}
+
+/* Writes back every sector that has been dirty since tick BEFORE or
+ * earlier. */
 static void
-page_cache_destroy (struct page *page) {
+cache_flush (int64_t before) {
+	lock_acquire (&cache_lock);
+	for (size_t i = 0; i < PAGE_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		if (e->valid && e->dirty && !e->busy && e->dirtied <= before)
+			cache_flush_entry (e);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Writes back every dirty sector. */
+void
+page_cache_writeback (void) {
+	cache_flush (INT64_MAX);
+}
+
+/* Writes back the dirty sectors among the CNT from SECTOR. */
+void
+page_cache_flush (disk_sector_t sector, size_t cnt) {
+	lock_acquire (&cache_lock);
+	for (size_t i = 0; i < PAGE_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		if (e->valid && e->sector >= sector && e->sector - sector < cnt) {
+			while (e->busy)
+				cond_wait (&io_done, &cache_lock);
+			/* It may have been evicted meanwhile. */
+			if (e->valid && e->dirty && e->sector >= sector
+					&& e->sector - sector < cnt)
+				cache_flush_entry (e);
+		}
+	}
+	lock_release (&cache_lock);
 }
 
 /* Worker thread for page cache */
+/* Reads in the sectors queued by page_cache_readahead(). */
+static void
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&ra_sema);
+		lock_acquire (&cache_lock);
+		disk_sector_t sector = ra_queue[ra_head];
+		ra_head = (ra_head + 1) % READAHEAD_QUEUE;
+		ra_cnt--;
+		/* Left unreferenced, so that it goes first if nobody reads it. */
+		cache_get (sector, true);
+		lock_release (&cache_lock);
+	}
+}
+
+/* Writes back sectors that have been dirty for page_cache_flush_ticks,
+ * and the FAT sectors changed since the last poll. */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_flushd (void *aux UNUSED) {
+	for (;;) {
+		int64_t poll = FLUSH_POLL_TICKS;
+		if (page_cache_flush_ticks > 0 && page_cache_flush_ticks < poll)
+			poll = page_cache_flush_ticks;
+		timer_sleep (poll);
+		if (page_cache_flush_ticks > 0) {
+			fat_writeback ();
+			cache_flush (timer_ticks () - page_cache_flush_ticks);
+		}
+	}
 }
@@ -0,0 +1,13 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+#include <stdbool.h>
+#include "devices/disk.h"
+
+void dcache_init (void);
+bool dcache_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *inumber, bool *is_dir);
+void dcache_insert (disk_sector_t parent, const char *name,
+		disk_sector_t inumber, bool is_dir);
+void dcache_invalidate (disk_sector_t parent, const char *name);
+void dcache_purge (disk_sector_t parent);
+#endif
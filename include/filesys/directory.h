@@ -24,9 +24,12 @@ struct inode *dir_get_inode (struct dir *);
 
 /* Reading and writing. */
 bool dir_lookup (const struct dir *, const char *name, struct inode **);
+bool dir_resolve (disk_sector_t parent, const char *name,
+		disk_sector_t *inumber, bool *is_dir);
 bool dir_add (struct dir *, const char *name, disk_sector_t);
 bool dir_remove (struct dir *, const char *name);
 bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
+void dir_seek (struct dir *, off_t new_pos);
 
 /* A directory. */
 struct dir {
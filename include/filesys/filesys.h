@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include "filesys/off_t.h"
+#include "filesys/directory.h"
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
@@ -16,7 +17,7 @@ void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
-struct dir *parse_path(char *path_name, char *file_name);
+struct dir *parse_path(const char *path_name, char file_name[NAME_MAX + 1]);
 bool filesys_create_dir(const char *name);
 
 #endif /* filesys/filesys.h */
@@ -6,34 +6,62 @@
 #include "devices/disk.h"
 
 #include "lib/kernel/list.h"
+#include "threads/synch.h"
 
 struct bitmap;
 
 
 
+/* Bytes of data an inode can hold itself. */
+#define INODE_INLINE_MAX 492
+
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
+	disk_sector_t start;                /* First data sector, or 0 if the
+	                                       data is in INLINE_DATA. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[124];               /* Not used. */
+	disk_sector_t dir_index;            /* Directory: inode of its hash
+	                                       index, or 0 if it has none. */
+	uint8_t inline_data[INODE_INLINE_MAX]; /* Data of a file of at most
+	                                       INODE_INLINE_MAX bytes. */
 
 	uint32_t is_dir;					/* file = 0, directory = 1 */
 	// uint32_t is_link;
 	// char link_name[492];
 };
 
+/* A run of a file's sectors that are consecutive on disk. */
+struct inode_extent {
+	uint32_t idx;                       /* First sector's index in the file. */
+	disk_sector_t sector;               /* First sector on disk. */
+	uint32_t len;                       /* Number of sectors. */
+};
+
 /* In-memory inode. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
-	disk_sector_t sector;               /* Sector number of disk location. */
+	struct list_elem elem;              /* Element in its hash bucket. */
+	struct list_elem lru_elem;          /* In warm_inodes, if closed. */
+	disk_sector_t sector;               /* Cluster holding the disk inode. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
+	bool dirty;                         /* DATA changed since written. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	off_t ra_pos;                       /* End of the last read. */
 	struct inode_disk data;             /* Inode content. */
+
+	/* Where the first MAPPED sectors of the file are, so that the FAT
+	 * chain is followed only once. */
+	struct lock extent_lock;
+	struct inode_extent *extents;       /* In file order. */
+	size_t extent_cnt, extent_cap;
+	uint32_t mapped;
+	uint32_t alloc_cnt;                 /* Clusters in the chain, with the
+	                                       preallocated ones past the end. */
 };
 
 
 void inode_init (void);
+void inode_done (void);
 bool inode_create (disk_sector_t, off_t, uint32_t);
 struct inode *inode_open (disk_sector_t);
 struct inode *inode_reopen (struct inode *);
@@ -42,9 +70,14 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+bool inode_allocate (struct inode *, off_t length);
+void inode_sync (struct inode *);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
 bool inode_is_dir(const struct inode *inode);
+bool inode_is_inline (const struct inode *);
+disk_sector_t inode_get_dir_index (const struct inode *);
+void inode_set_dir_index (struct inode *, disk_sector_t index);
 
 #endif /* filesys/inode.h */
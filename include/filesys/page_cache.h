@@ -1,12 +1,24 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
-#include "vm/vm.h"
-
-struct page;
-enum vm_type;
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/disk.h"
 
+/* Unused: the cache holds disk sectors, not pages, but struct page
+   still has a member of this type. */
 struct page_cache {};
 
+/* Ticks a sector may stay dirty before the flush daemon writes it back;
+   0 leaves dirty sectors, and the FAT, until they are evicted, synced or
+   the file system is shut down.  Set with the "-fs-flush=TICKS" kernel option. */
+extern int64_t page_cache_flush_ticks;
+
 void page_cache_init (void);
-bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+void pagecache_init (void);
+void page_cache_read (disk_sector_t sector, void *buffer, int ofs, int size);
+void page_cache_write (disk_sector_t sector, const void *buffer, int ofs,
+		int size);
+void page_cache_readahead (disk_sector_t sector);
+void page_cache_writeback (void);
+void page_cache_flush (disk_sector_t sector, size_t cnt);
 #endif
@@ -36,6 +36,74 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Virtual memory hints. */
+	SYS_MADVISE,                /* Advise the pager about a range. */
+	SYS_MLOCK,                  /* Pin a range in memory. */
+	SYS_MUNLOCK,                /* Unpin a range. */
+	SYS_MSYNC,                  /* Write back a file mapping. */
+	SYS_FAULTSTAT,              /* Read page fault statistics. */
+	SYS_RSSLIMIT,               /* Limit the resident set. */
+	SYS_RSSSTAT,                /* Read resident set statistics. */
+
+	/* Shared memory. */
+	SYS_SHMGET,                 /* Create or look up a segment. */
+	SYS_SHMAT,                  /* Map a segment. */
+	SYS_SHMDT,                  /* Unmap a segment. */
+
+	/* File system extras. */
+	SYS_FALLOCATE,              /* Allocate disk space for a file. */
+	SYS_FSYNC,                  /* Write a file back to disk. */
+};
+
+/* Key for SYS_SHMGET that always creates a new segment. */
+#define SHM_PRIVATE 0
+
+/* Flags for SYS_MMAP. */
+#define MAP_POPULATE 1              /* Load the whole mapping up front. */
+
+/* Advice for SYS_MADVISE. */
+enum {
+	MADV_NORMAL,                /* Default fault-around. */
+	MADV_RANDOM,                /* No fault-around. */
+	MADV_SEQUENTIAL,            /* Read further ahead of faults. */
+	MADV_WILLNEED,              /* Load the range now. */
+	MADV_DONTNEED,              /* Drop the range's contents. */
+};
+
+/* Flags for SYS_MSYNC. */
+#define MS_ASYNC 1                  /* Schedule writeback and return. */
+#define MS_INVALIDATE 2             /* Accepted; there is no other copy. */
+#define MS_SYNC 4                   /* Write back before returning. */
+
+/* Page fault classes, for SYS_FAULTSTAT. */
+enum fault_class {
+	FAULT_ANON,                 /* First touch of an anonymous page. */
+	FAULT_FILE,                 /* First touch of a file mapping. */
+	FAULT_TEXT,                 /* Executable text, read or shared. */
+	FAULT_SWAP,                 /* Evicted page brought back. */
+	FAULT_STACK,                /* Stack growth. */
+	FAULT_ZERO,                 /* Read mapped to the zero page. */
+	FAULT_COW,                  /* First write to the zero page. */
+	FAULT_SPURIOUS,             /* Page was already mapped. */
+	FAULT_BAD,                  /* Not handled; the process dies. */
+	FAULT_CLASS_CNT
+};
+
+/* Scopes for SYS_FAULTSTAT. */
+#define FAULTSTAT_SELF 0            /* Faults taken by this process. */
+#define FAULTSTAT_ALL 1             /* Faults taken by every process. */
+
+/* Latency histogram buckets: bucket B counts faults that took
+   2**B to 2**(B+1) - 1 TSC cycles. */
+#define FAULT_HIST_BUCKETS 32
+
+/* Fields for SYS_RSSSTAT. */
+enum rss_stat {
+	RSS_PAGES,                  /* Frames mapped by this process. */
+	RSS_LIMIT,                  /* Its limit, 0 if none. */
+	RSS_EVICT_CAUSED,           /* Frames it evicted to fault pages in. */
+	RSS_EVICT_SUFFERED,         /* Its pages evicted by anyone. */
 };
 
 #endif /* lib/syscall-nr.h */
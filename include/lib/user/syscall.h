@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <syscall-nr.h>             /* MAP_*, MADV_*, MS_*, FAULT_*. */
 
 /* Process identifier. */
 typedef int pid_t;
@@ -40,7 +41,21 @@ int dup2(int oldfd, int newfd);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void *mmap_flags (void *addr, size_t length, int writable, int fd,
+		off_t offset, int flags);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+int mlock (const void *addr, size_t length);
+int munlock (const void *addr, size_t length);
+int msync (void *addr, size_t length, int flags);
+long long faultstat (int scope, int class, int bucket);
+int rsslimit (int pages);
+long long rssstat (int field);
+int shmget (int key, size_t size);
+void *shmat (int id, void *addr);
+int shmdt (void *addr);
+int fallocate (int fd, off_t offset, off_t len);
+int fsync (int fd);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -2,24 +2,54 @@
 #define THREAD_MMU_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "threads/pte.h"
 
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
+/* False to leave TLB tagging with PCIDs off ("-no-pcid"). */
+extern bool pcid_allowed;
+
+void pcid_init (void);
+
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
+uint64_t *pml4e_walk_pde (uint64_t *pml4, const uint64_t va, int create);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
 void pml4_destroy (uint64_t *pml4);
 void pml4_activate (uint64_t *pml4);
 void *pml4_get_page (uint64_t *pml4, const void *upage);
 bool pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw);
+bool pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw);
 void pml4_clear_page (uint64_t *pml4, void *upage);
 bool pml4_is_dirty (uint64_t *pml4, const void *upage);
 void pml4_set_dirty (uint64_t *pml4, const void *upage, bool dirty);
+bool pml4_test_and_clear_dirty (uint64_t *pml4, const void *upage);
 bool pml4_is_accessed (uint64_t *pml4, const void *upage);
 void pml4_set_accessed (uint64_t *pml4, const void *upage, bool accessed);
 
+/* Pages and page tables taken out of one page table, whose TLB entries
+ * are invalidated together by mmu_gather_finish().  Past
+ * MMU_GATHER_PAGES pages the whole TLB of the address space is flushed
+ * instead of one entry per page. */
+#define MMU_GATHER_PAGES 32
+#define MMU_GATHER_TABLES 8
+
+struct mmu_gather {
+	uint64_t *pml4;
+	size_t page_cnt;
+	void *pages[MMU_GATHER_PAGES];
+	bool flush_all;
+	size_t table_cnt;
+	void *tables[MMU_GATHER_TABLES];    /* Freed after the flush. */
+};
+
+void mmu_gather_init (struct mmu_gather *, uint64_t *pml4);
+void mmu_gather_clear_page (struct mmu_gather *, void *upage);
+void mmu_gather_free_tables (struct mmu_gather *, void *start, void *end);
+void mmu_gather_finish (struct mmu_gather *);
+
 #define is_writable(pte) (*(pte) & PTE_W)
 #define is_user_pte(pte) (*(pte) & PTE_U)
 #define is_kern_pte(pte) (!is_user_pte (pte))
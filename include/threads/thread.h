@@ -8,6 +8,7 @@
 #include "threads/synch.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/faultstat.h"
 #endif
 
 
@@ -145,6 +146,12 @@ struct thread {
 	struct supplemental_page_table spt;
 	void* stack_bottom;
 	void* rsp_stack;
+	uint64_t fault_cnt[FAULT_CLASS_CNT];	/* Page faults by class. */
+	uint64_t exec_tsc;                  /* TSC at exec(), until main(). */
+	size_t rss;                         /* Frames mapped, vm/replace.c. */
+	size_t rss_limit;                   /* Most frames to keep, or 0. */
+	uint64_t evict_caused;              /* Evictions this process forced. */
+	uint64_t evict_suffered;            /* Its pages that were evicted. */
 #endif
 
 	/* Owned by thread.c. */
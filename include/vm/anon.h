@@ -7,12 +7,14 @@
 #define DISK_SECTOR_SIZE 512
 
 struct page;
+struct zswap_entry;
 enum vm_type;
 
 // anonymous page는 file-backed page와 달리 contents를 가져올 file이나 device가 없는 page를 말한다. 이들은 프로세스 자체에서 런타임 때 만들어지고 사용된다. stack 과 heap 영역의 메모리들이 여기에 해당된다.
 struct anon_page {
     //struct page anon_p;
     int swap_sector; // swap된 내용이 저장되는 sector
+    struct zswap_entry *zswap; // 압축 풀(zswap)에 저장된 경우의 엔트리, 아니면 NULL
 };
 
 // [include>vm>anon.h] 추가
@@ -21,10 +23,14 @@ struct anon_page {
 // 이를 페이지 단위로 관리하려면 섹터 단위를 페이지 단위로 바꿔줄 필요가 있음.
 // 이 단위가 SECTORS_PER_PAGE! (8섹터 당 1페이지 관리)
 
-struct bitmap *swap_table; // 0 - empty, 1 - filled
-int swap_size;
+extern struct bitmap *swap_table; // 0 - empty, 1 - filled
+extern int swap_size;
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+bool anon_swap_write (struct page *page, const void *kva);
+int swap_slot_write (const void *kva);
+void swap_slot_read (int slot, void *kva);
+void swap_slot_free (int slot);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,12 @@
+#ifndef VM_FAULTSTAT_H
+#define VM_FAULTSTAT_H
+#include <stdint.h>
+#include <syscall-nr.h>
+
+void faultstat_record (enum fault_class cls, uint64_t cycles);
+void faultstat_exec_start (void);
+void faultstat_exec_main (void);
+int64_t faultstat_get (int scope, int cls, int bucket);
+void faultstat_print (void);
+
+#endif /* vm/faultstat.h */
@@ -10,9 +10,26 @@ enum vm_type;
 struct file_page {
 };
 
+/* Read-only executable text.  Loaded frames are kept in a cache keyed by
+ * (inode, offset) so that other processes can map them too. */
+struct text_page {
+	struct file *file;
+	off_t offset;
+	size_t read_bytes;
+};
+
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool text_initializer (struct page *page, enum vm_type type, void *kva);
+bool text_attach (struct page *page);
+void text_publish (struct page *page);
 void *do_mmap(void *addr, size_t length, int writable,
-		struct file *file, off_t offset);
+		struct file *file, off_t offset, int flags);
 void do_munmap (void *va);
+int do_msync (void *addr, size_t length, int flags);
+void mmap_writeback (uint8_t *start, uint8_t *end);
+
+/* Ticks between background writebacks of dirty mmap pages; 0 disables
+   them.  Set with the "-mmap-flush=TICKS" kernel option. */
+extern int64_t mmap_flush_ticks;
 #endif
@@ -0,0 +1,46 @@
+#ifndef VM_REPLACE_H
+#define VM_REPLACE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct frame;
+struct page;
+struct thread;
+
+/* A page replacement policy.  A frame belongs to the policy from the
+ * moment it gets its first page, on_map(), until it loses its last one
+ * or is picked for eviction, on_unmap().  Every hook runs with
+ * frame_table_lock held. */
+struct replace_policy {
+	const char *name;
+	void (*init) (void);
+	void (*on_map) (struct frame *frame);
+	/* The accessed bit of FRAME was found set, and cleared. */
+	void (*on_access_sample) (struct frame *frame);
+	/* Returns the frame to evict, or NULL if every frame is pinned. */
+	struct frame *(*pick_victim) (void);
+	/* EVICTED is true if FRAME was returned by pick_victim(). */
+	void (*on_unmap) (struct frame *frame, bool evicted);
+};
+
+/* Name of the policy to use: "clock" (default), "clock2", "clockpro"
+ * or "arc".  Set with the "-vmpolicy=NAME" kernel option. */
+extern const char *replace_policy_name;
+
+void replace_init (void);
+void replace_on_map (struct frame *frame);
+void replace_on_unmap (struct frame *frame);
+struct frame *replace_pick_victim (struct thread *owner);
+
+/* Resident limit of the first process, inherited by its children.  Set
+ * with the "-rss-limit=PAGES" kernel option; 0 means none. */
+extern size_t rss_default_limit;
+
+void rss_charge (struct thread *t, int pages);
+bool rss_at_limit (const struct thread *t);
+size_t rss_set_limit (struct thread *t, size_t pages);
+void rss_evicted (struct page *page);
+int64_t rss_stat_get (int field);
+
+#endif /* vm/replace.h */
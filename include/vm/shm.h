@@ -0,0 +1,24 @@
+#ifndef VM_SHM_H
+#define VM_SHM_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct page;
+struct shm_segment;
+
+/* One page of an attached shared memory segment.  Every process that
+ * attaches the segment has its own page for each page of the segment;
+ * the frame belongs to the segment. */
+struct shm_page {
+	struct shm_segment *seg;
+	size_t idx;                /* Page number within SEG. */
+};
+
+void vm_shm_init (void);
+int do_shmget (int key, size_t size);
+void *do_shmat (int id, void *addr);
+int do_shmdt (void *addr);
+bool shm_claim (struct page *page);
+bool shm_fork (struct page *parent);
+
+#endif /* vm/shm.h */
@@ -22,14 +22,23 @@ enum vm_type {
 	 * markers, until the value is fit in the int. */
 	VM_MARKER_0 = (1 << 3),
 	VM_MARKER_1 = (1 << 4),
+	VM_MARKER_2 = (1 << 5),
 
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
 };
 
+/* Marks anonymous pages that hold read-only executable text.  Their
+ * frames are shared between processes running the same binary. */
+#define VM_TEXT VM_MARKER_1
+
+/* Marks anonymous pages of a shared memory segment (vm/shm.c). */
+#define VM_SHM VM_MARKER_2
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
+#include "vm/shm.h"
 #ifdef EFILESYS
 #include "filesys/page_cache.h"
 #endif
@@ -49,7 +58,11 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
-	struct hash_elem hash_elem;
+	struct thread *owner;         /* Process whose page table maps this. */
+	struct list_elem rmap_elem;   /* Element in frame->rmap. */
+	bool locked;                  /* mlock()ed: frame is never evicted. */
+	bool pinned;                  /* Frame pinned by vm_page_settle(). */
+	uint8_t advice;               /* MADV_* hint from madvise(). */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -57,6 +70,8 @@ struct page {
 		struct uninit_page uninit;
 		struct anon_page anon;
 		struct file_page file;
+		struct text_page text;
+		struct shm_page shm;
 #ifdef EFILESYS
 		struct page_cache page_cache;
 #endif
@@ -68,10 +83,30 @@ struct page {
 // project3
 struct frame {
 	void *kva; //kernel virtual address
-	struct page *page;
+	struct page *page;            // rmap 중 하나 (공유되지 않으면 유일한 page)
 	struct list_elem frame_elem;
+	struct list rmap;             /* Pages that map this frame. */
+	int refcnt;                   /* Number of pages in rmap. */
+	int pin_cnt;                  /* Pages in rmap that are locked. */
+	bool evicting;                /* Being written out by the pager,
+	                                 under frame_table_lock. */
+
+	/* Page replacement (vm/replace.c), under frame_table_lock. */
+	struct list_elem repl_elem;
+	bool repl_tracked;            /* Known to the policy. */
+	int repl_state;               /* Policy-specific. */
+
+	/* Shared text frames only: key in the text cache (vm/file.c). */
+	struct inode *inode;
+	off_t offset;
+	struct hash_elem text_elem;
 };
 
+/* All frames that hold user pages (vm/vm.c).  mmap_writeback_all() may
+ * keep a bare list_elem in it as a cursor while it walks. */
+extern struct list frame_table;
+extern struct lock frame_table_lock;
+
 /* The function table for page operations.
  * This is one way of implementing "interface" in C.
  * Put the table of "method" into the struct's member, and
@@ -91,9 +126,32 @@ struct page_operations {
 /* Representation of current process's memory space.
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
-//page fault 및 resource management를 처리하기 위해 각 page에 대한 추가 정보를 저장할 수 있는 supplementary page table - hash_table로 구현
-struct supplemental_page_table { 
-	struct hash spt_hash; // project3 
+//page fault 및 resource management를 처리하기 위해 각 page에 대한 추가 정보를 저장할 수 있는 supplementary page table
+// 연속된 page들을 영역(vma) 단위로 묶고, 영역들은 시작 주소 순으로 정렬해 둔다.
+// 조회는 영역에 대한 이진 탐색 + 배열 인덱싱이므로 아무것도 할당하지 않는다.
+
+/* A run of contiguous user pages with the same permission.  Pages are
+ * kept in a slot array indexed by page number within the run.
+ *
+ * TODO: Per-page metadata is not compact yet.  Every page still costs a
+ * malloc'd struct page, a malloc'd struct container for its backing and
+ * an 8-byte slot.  The rest of the work is tracked on its own: keep the
+ * backing (file, offset, read bytes) in the region, give each slot a
+ * few bytes of state, and allocate a struct page only once the page is
+ * loaded. */
+struct vma {
+	void *start;            /* First page. */
+	void *end;              /* One past the last page. */
+	bool writable;
+	size_t page_cnt;        /* Number of non-null slots. */
+	size_t slot_cap;        /* Allocated length of PAGES. */
+	struct page **pages;    /* (end - start) / PGSIZE slots. */
+};
+
+struct supplemental_page_table {
+	struct vma *vmas;       /* Sorted by start, never overlapping. */
+	size_t vma_cnt;
+	size_t vma_cap;
 };
 
 #include "threads/thread.h"
@@ -105,6 +163,12 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_delete_page (struct supplemental_page_table *spt, struct page *page);
+
+extern size_t fault_around_pages;
+extern bool fault_around_mmap;
+extern bool vm_hugepages;
+extern size_t mlock_limit;
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
@@ -115,8 +179,15 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+struct frame *vm_get_frame (void);
+void vm_frame_link (struct frame *frame, struct page *page);
+int vm_page_unmap (struct page *page);
+void vm_page_settle (struct page *page);
+void vm_frame_free (struct frame *frame);
 bool vm_claim_page (void *va);
 enum vm_type page_get_type (struct page *page);
-void spt_dealloc(struct hash_elem *e, void *aux);
+void vm_populate (void *addr, size_t length);
+int vm_madvise (void *addr, size_t length, int advice);
+int vm_mlock (void *addr, size_t length, bool lock);
 
 #endif  /* VM_VM_H */
\ No newline at end of file
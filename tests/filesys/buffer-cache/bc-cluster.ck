@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my (@times) = grep (/^\(bc-cluster\) (sequential|small-file) (write|read): \d+ cycles$/, @output);
+fail "no timings reported\n" if @times != 4;
+my (%times) = map (($_ => 1), @times);
+@output = grep (!$times{$_}, @output);
+common_checks ("run", @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(bc-cluster) begin
+(bc-cluster) create "big"
+(bc-cluster) open "big"
+(bc-cluster) sequential workload is correct
+(bc-cluster) remove "big"
+(bc-cluster) small-file workload is correct
+(bc-cluster) end
+EOF
+pass;
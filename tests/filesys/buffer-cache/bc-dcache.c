@@ -0,0 +1,52 @@
+/* Opens a file at the end of a deep path, and a missing name next to
+   it, again and again, and checks that once the path is cached this
+   reads nothing from disk.  Then checks that removing and creating
+   names is seen through the cache. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OPEN_CNT 50
+
+static const char file_name[] = "/a/b/c/d/e/file";
+static const char missing_name[] = "/a/b/c/d/e/missing";
+
+void
+test_main (void)
+{
+  long long read_cnt;
+  int i, fd;
+
+  CHECK (mkdir ("/a"), "mkdir \"/a\"");
+  CHECK (mkdir ("/a/b"), "mkdir \"/a/b\"");
+  CHECK (mkdir ("/a/b/c"), "mkdir \"/a/b/c\"");
+  CHECK (mkdir ("/a/b/c/d"), "mkdir \"/a/b/c/d\"");
+  CHECK (mkdir ("/a/b/c/d/e"), "mkdir \"/a/b/c/d/e\"");
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+
+  /* Warm up the caches. */
+  close (open (file_name));
+  open (missing_name);
+
+  read_cnt = get_fs_disk_read_cnt ();
+  for (i = 0; i < OPEN_CNT; i++)
+    {
+      if ((fd = open (file_name)) < 2)
+        fail ("open \"%s\" failed", file_name);
+      close (fd);
+      if (open (missing_name) != -1)
+        fail ("open \"%s\" succeeded", missing_name);
+    }
+  CHECK (get_fs_disk_read_cnt () == read_cnt,
+         "%d cached lookups read nothing from disk", 2 * OPEN_CNT);
+
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+  CHECK (open (file_name) == -1, "open \"%s\" (must fail)", file_name);
+  CHECK (create (missing_name, 0), "create \"%s\"", missing_name);
+  CHECK ((fd = open (missing_name)) > 1, "open \"%s\"", missing_name);
+  close (fd);
+  CHECK (chdir ("/a/b/c"), "chdir \"/a/b/c\"");
+  CHECK ((fd = open ("d/e/missing")) > 1, "open \"d/e/missing\"");
+  close (fd);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-dcache) begin
+(bc-dcache) mkdir "/a"
+(bc-dcache) mkdir "/a/b"
+(bc-dcache) mkdir "/a/b/c"
+(bc-dcache) mkdir "/a/b/c/d"
+(bc-dcache) mkdir "/a/b/c/d/e"
+(bc-dcache) create "/a/b/c/d/e/file"
+(bc-dcache) 100 cached lookups read nothing from disk
+(bc-dcache) remove "/a/b/c/d/e/file"
+(bc-dcache) open "/a/b/c/d/e/file" (must fail)
+(bc-dcache) create "/a/b/c/d/e/missing"
+(bc-dcache) open "/a/b/c/d/e/missing"
+(bc-dcache) chdir "/a/b/c"
+(bc-dcache) open "d/e/missing"
+(bc-dcache) end
+EOF
+pass;
@@ -0,0 +1,99 @@
+/* Fills a directory well past the size at which it gets a hash index,
+   removes and re-creates files in it, and checks that every name is
+   found, that removed names are not, and that readdir() returns
+   the same names in the same order each time. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 300
+
+static char names[FILE_CNT][READDIR_MAX_LEN + 1];
+
+/* Reads directory "." and checks that it holds CNT files in the order
+   of NAMES, or stores the order in NAMES if STORE. */
+static void
+check_readdir (int cnt, bool store)
+{
+  char name[READDIR_MAX_LEN + 1];
+  int fd, n;
+
+  if ((fd = open (".")) < 2)
+    fail ("open \".\" failed");
+  for (n = 0; readdir (fd, name); n++)
+    {
+      if (n >= cnt)
+        fail ("readdir returned more than %d names", cnt);
+      if (store)
+        strlcpy (names[n], name, sizeof names[n]);
+      else if (strcmp (names[n], name))
+        fail ("readdir name %d is \"%s\", was \"%s\"", n, name, names[n]);
+    }
+  if (n != cnt)
+    fail ("readdir returned %d names, expected %d", n, cnt);
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  char name[16];
+  int i, fd;
+
+  CHECK (mkdir ("big"), "mkdir \"big\"");
+  CHECK (chdir ("big"), "chdir \"big\"");
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  msg ("created %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i += 3)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      fd = open (name);
+      if (i % 3 == 0 && fd >= 0)
+        fail ("removed \"%s\" still opens", name);
+      if (i % 3 != 0 && fd < 2)
+        fail ("open \"%s\" failed", name);
+      if (fd >= 2)
+        close (fd);
+    }
+  msg ("removed every third file");
+
+  check_readdir (FILE_CNT - (FILE_CNT + 2) / 3, true);
+  check_readdir (FILE_CNT - (FILE_CNT + 2) / 3, false);
+  msg ("readdir order is stable");
+
+  for (i = 0; i < FILE_CNT; i += 3)
+    {
+      snprintf (name, sizeof name, "new%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, i % 3 ? "file%d" : "new%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  CHECK (!create ("file1", 0), "create existing \"file1\" (must fail)");
+  msg ("re-created the removed files under new names");
+
+  check_readdir (FILE_CNT, true);
+  check_readdir (FILE_CNT, false);
+  msg ("readdir order is stable");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-dir-hash) begin
+(bc-dir-hash) mkdir "big"
+(bc-dir-hash) chdir "big"
+(bc-dir-hash) created 300 files
+(bc-dir-hash) removed every third file
+(bc-dir-hash) readdir order is stable
+(bc-dir-hash) create existing "file1" (must fail)
+(bc-dir-hash) re-created the removed files under new names
+(bc-dir-hash) readdir order is stable
+(bc-dir-hash) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Preallocates space for a file with fallocate(), which must
+   extend it with zeros without touching the data already in it,
+   and checks that bad requests are refused. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ALLOC_SIZE (64 * 1024)
+
+static const char file_name[] = "prealloc";
+static char buf[ALLOC_SIZE];
+
+void
+test_main (void)
+{
+  static const char data[] = "preallocated";
+  size_t i;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (fallocate (fd, 0, ALLOC_SIZE) == 0, "fallocate %d bytes", ALLOC_SIZE);
+  CHECK (filesize (fd) == ALLOC_SIZE, "file size is %d", ALLOC_SIZE);
+
+  CHECK (read (fd, buf, ALLOC_SIZE) == ALLOC_SIZE, "read file");
+  for (i = 0; i < ALLOC_SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu is %d, not zero", i, buf[i]);
+
+  seek (fd, 1000);
+  CHECK (write (fd, data, sizeof data) == sizeof data, "write \"%s\"", data);
+  CHECK (fallocate (fd, 0, 100) == 0, "fallocate inside the file");
+  CHECK (filesize (fd) == ALLOC_SIZE, "file size is still %d", ALLOC_SIZE);
+  CHECK (fallocate (fd, ALLOC_SIZE, 4096) == 0, "fallocate past the end");
+  CHECK (filesize (fd) == ALLOC_SIZE + 4096, "file size is %d",
+         ALLOC_SIZE + 4096);
+
+  seek (fd, 1000);
+  CHECK (read (fd, buf, sizeof data) == sizeof data, "read \"%s\"", data);
+  if (memcmp (buf, data, sizeof data))
+    fail ("data changed");
+
+  CHECK (fallocate (fd, -1, 10) == -1, "fallocate at a negative offset");
+  CHECK (fallocate (fd, 0, 0) == -1, "fallocate no bytes");
+  CHECK (fallocate (1, 0, 10) == -1, "fallocate stdout");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
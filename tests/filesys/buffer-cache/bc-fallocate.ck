@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-fallocate) begin
+(bc-fallocate) create "prealloc"
+(bc-fallocate) open "prealloc"
+(bc-fallocate) fallocate 65536 bytes
+(bc-fallocate) file size is 65536
+(bc-fallocate) read file
+(bc-fallocate) write "preallocated"
+(bc-fallocate) fallocate inside the file
+(bc-fallocate) file size is still 65536
+(bc-fallocate) fallocate past the end
+(bc-fallocate) file size is 69632
+(bc-fallocate) read "preallocated"
+(bc-fallocate) fallocate at a negative offset
+(bc-fallocate) fallocate no bytes
+(bc-fallocate) fallocate stdout
+(bc-fallocate) close "prealloc"
+(bc-fallocate) end
+EOF
+pass;
@@ -0,0 +1,34 @@
+/* Writes a file, which stays dirty in the buffer cache, and checks
+   that fsync() writes all of its sectors to disk. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE 8192
+
+static const char file_name[] = "synced";
+static char buf[TEST_SIZE];
+
+void
+test_main (void)
+{
+  long long write_cnt;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+
+  write_cnt = get_fs_disk_write_cnt ();
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  CHECK (get_fs_disk_write_cnt () >= write_cnt + TEST_SIZE / 512,
+         "check write_cnt");
+  CHECK (fsync (1) == -1, "fsync stdout");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-fsync) begin
+(bc-fsync) create "synced"
+(bc-fsync) open "synced"
+(bc-fsync) write "synced"
+(bc-fsync) fsync "synced"
+(bc-fsync) check write_cnt
+(bc-fsync) fsync stdout
+(bc-fsync) close "synced"
+(bc-fsync) open "synced" for verification
+(bc-fsync) verified contents of "synced"
+(bc-fsync) close "synced"
+(bc-fsync) end
+EOF
+pass;
@@ -0,0 +1,76 @@
+/* Writes small files, which are kept inside their inodes, reads them
+   back, and grows one past what an inode holds, checking the data at
+   each step. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SMALL_SIZE 10
+#define INLINE_SIZE 480
+#define BIG_SIZE 2000
+
+static char buf[BIG_SIZE];
+static char data[BIG_SIZE];
+
+/* Checks that file NAME holds the SIZE bytes of DATA. */
+static void
+check_data (const char *name, size_t size)
+{
+  int fd;
+
+  if ((fd = open (name)) < 2)
+    fail ("open \"%s\" failed", name);
+  if (filesize (fd) != (int) size)
+    fail ("\"%s\" is %d bytes, expected %zu", name, filesize (fd), size);
+  if (read (fd, buf, sizeof buf) != (int) size)
+    fail ("read \"%s\" failed", name);
+  if (memcmp (buf, data, size))
+    fail ("\"%s\" holds the wrong data", name);
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  int fd;
+
+  random_bytes (data, sizeof data);
+
+  CHECK (create ("small", 0), "create \"small\"");
+  CHECK ((fd = open ("small")) > 1, "open \"small\"");
+  CHECK (write (fd, data, SMALL_SIZE) == SMALL_SIZE,
+         "write %d bytes", SMALL_SIZE);
+  close (fd);
+  check_data ("small", SMALL_SIZE);
+  msg ("\"small\" is correct");
+
+  CHECK (create ("grow", 0), "create \"grow\"");
+  CHECK ((fd = open ("grow")) > 1, "open \"grow\"");
+  CHECK (write (fd, data, INLINE_SIZE) == INLINE_SIZE,
+         "write %d bytes", INLINE_SIZE);
+  close (fd);
+  check_data ("grow", INLINE_SIZE);
+  msg ("\"grow\" is correct at %d bytes", INLINE_SIZE);
+
+  CHECK ((fd = open ("grow")) > 1, "open \"grow\"");
+  seek (fd, INLINE_SIZE);
+  CHECK (write (fd, data + INLINE_SIZE, BIG_SIZE - INLINE_SIZE)
+         == BIG_SIZE - INLINE_SIZE, "write %d more bytes",
+         BIG_SIZE - INLINE_SIZE);
+  close (fd);
+  check_data ("grow", BIG_SIZE);
+  msg ("\"grow\" is correct at %d bytes", BIG_SIZE);
+
+  CHECK (create ("sparse", 0), "create \"sparse\"");
+  CHECK ((fd = open ("sparse")) > 1, "open \"sparse\"");
+  seek (fd, 100);
+  CHECK (write (fd, data + 100, SMALL_SIZE) == SMALL_SIZE,
+         "write %d bytes at 100", SMALL_SIZE);
+  close (fd);
+  memset (data, 0, 100);
+  check_data ("sparse", 100 + SMALL_SIZE);
+  msg ("\"sparse\" is correct");
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-inline) begin
+(bc-inline) create "small"
+(bc-inline) open "small"
+(bc-inline) write 10 bytes
+(bc-inline) "small" is correct
+(bc-inline) create "grow"
+(bc-inline) open "grow"
+(bc-inline) write 480 bytes
+(bc-inline) "grow" is correct at 480 bytes
+(bc-inline) open "grow"
+(bc-inline) write 1520 more bytes
+(bc-inline) "grow" is correct at 2000 bytes
+(bc-inline) create "sparse"
+(bc-inline) open "sparse"
+(bc-inline) write 10 bytes at 100
+(bc-inline) "sparse" is correct
+(bc-inline) end
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Grows a few files with many small writes, then reopens them again
+   and again, and checks that their sizes were kept and that reopening
+   files used lately reads nothing from disk. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 16
+#define WRITE_CNT 64
+#define REOPEN_CNT 20
+
+void
+test_main (void)
+{
+  char name[16], buf[16];
+  long long read_cnt;
+  int i, j, fd;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "warm%d", i);
+      if (!create (name, 0) || (fd = open (name)) < 2)
+        fail ("create \"%s\" failed", name);
+      for (j = 0; j < WRITE_CNT; j++)
+        if (write (fd, buf, i + 1) != i + 1)
+          fail ("write \"%s\" failed", name);
+      close (fd);
+    }
+  msg ("grew %d files with %d writes each", FILE_CNT, WRITE_CNT);
+
+  read_cnt = get_fs_disk_read_cnt ();
+  for (j = 0; j < REOPEN_CNT; j++)
+    for (i = 0; i < FILE_CNT; i++)
+      {
+        snprintf (name, sizeof name, "warm%d", i);
+        if ((fd = open (name)) < 2)
+          fail ("open \"%s\" failed", name);
+        if (filesize (fd) != WRITE_CNT * (i + 1))
+          fail ("\"%s\" is %d bytes, expected %d", name, filesize (fd),
+                WRITE_CNT * (i + 1));
+        close (fd);
+      }
+  msg ("file sizes are correct");
+  CHECK (get_fs_disk_read_cnt () == read_cnt,
+         "reopening read nothing from disk");
+}
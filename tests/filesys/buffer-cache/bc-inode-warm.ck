@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-inode-warm) begin
+(bc-inode-warm) grew 16 files with 64 writes each
+(bc-inode-warm) file sizes are correct
+(bc-inode-warm) reopening read nothing from disk
+(bc-inode-warm) end
+EOF
+pass;
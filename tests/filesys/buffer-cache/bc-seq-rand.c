@@ -0,0 +1,94 @@
+/* Reads a 2 MB file sequentially and then at random offsets,
+   checking every byte, and reports how long each pass took.
+   Finding a sector of a large file must not mean following its
+   cluster chain from the start. */
+
+#include <random.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (2 * 1024 * 1024)
+#define CHUNK_SIZE 4096
+#define RANDOM_READS 2048
+#define SECTOR_SIZE 512
+
+static const char file_name[] = "big";
+static char buf[CHUNK_SIZE];
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* The byte at OFS of the file. */
+static char
+expected (size_t ofs)
+{
+  return ofs / SECTOR_SIZE * 7 + ofs;
+}
+
+static void
+check (const char *what, size_t ofs, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (buf[i] != expected (ofs + i))
+      fail ("%s: byte %zu is wrong", what, ofs + i);
+}
+
+void
+test_main (void)
+{
+  uint64_t start, seq_cycles, rand_cycles;
+  size_t ofs, i;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      for (i = 0; i < CHUNK_SIZE; i++)
+        buf[i] = expected (ofs + i);
+      if (write (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+        fail ("write at %zu failed", ofs);
+    }
+  msg ("write %d bytes", FILE_SIZE);
+  CHECK (filesize (fd) == FILE_SIZE, "file size is %d", FILE_SIZE);
+
+  seek (fd, 0);
+  start = rdtsc ();
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      if (read (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+        fail ("read at %zu failed", ofs);
+      check ("sequential", ofs, CHUNK_SIZE);
+    }
+  seq_cycles = rdtsc () - start;
+  msg ("sequential read is correct");
+
+  random_init (0);
+  start = rdtsc ();
+  for (i = 0; i < RANDOM_READS; i++)
+    {
+      ofs = random_ulong () % (FILE_SIZE / SECTOR_SIZE) * SECTOR_SIZE;
+      seek (fd, ofs);
+      if (read (fd, buf, SECTOR_SIZE) != SECTOR_SIZE)
+        fail ("read at %zu failed", ofs);
+      check ("random", ofs, SECTOR_SIZE);
+    }
+  rand_cycles = rdtsc () - start;
+  msg ("random read is correct");
+
+  /* Not part of the expected output: depends on the machine. */
+  msg ("sequential: %llu cycles", seq_cycles);
+  msg ("random: %llu cycles", rand_cycles);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my (@times) = grep (/^\(bc-seq-rand\) (sequential|random): \d+ cycles$/, @output);
+fail "no timings reported\n" if @times != 2;
+my (%times) = map (($_ => 1), @times);
+@output = grep (!$times{$_}, @output);
+common_checks ("run", @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(bc-seq-rand) begin
+(bc-seq-rand) create "big"
+(bc-seq-rand) open "big"
+(bc-seq-rand) write 2097152 bytes
+(bc-seq-rand) file size is 2097152
+(bc-seq-rand) sequential read is correct
+(bc-seq-rand) random read is correct
+(bc-seq-rand) close "big"
+(bc-seq-rand) end
+EOF
+pass;
@@ -0,0 +1,23 @@
+/* Child process of zero-page-read.
+   Checks that its untouched bss pages read as zeros. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 4
+
+static char buf[PAGE_COUNT * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+int
+main (int argc UNUSED, char *argv[] UNUSED)
+{
+  size_t i;
+
+  test_name = "child-zero";
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != '\0')
+      fail ("byte %zu != 0", i);
+
+  return 0x42;
+}
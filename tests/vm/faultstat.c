@@ -0,0 +1,42 @@
+/* Checks that page faults are classified and counted per process: a
+   read of untouched .bss is a zero-page fault, the first write to it
+   a copy-on-write fault, and the system-wide histogram saw them. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+static long long
+hist_total (int class)
+{
+  long long total = 0;
+  int b;
+
+  for (b = 0; b < FAULT_HIST_BUCKETS; b++)
+    total += faultstat (FAULTSTAT_ALL, class, b);
+  return total;
+}
+
+void
+test_main (void)
+{
+  long long zero = faultstat (FAULTSTAT_SELF, FAULT_ZERO, -1);
+  long long cow = faultstat (FAULTSTAT_SELF, FAULT_COW, -1);
+
+  CHECK (buf[0] == 0, "read untouched page");
+  CHECK (faultstat (FAULTSTAT_SELF, FAULT_ZERO, -1) == zero + 1,
+         "one zero-page fault");
+  buf[0] = 'x';
+  CHECK (faultstat (FAULTSTAT_SELF, FAULT_COW, -1) == cow + 1,
+         "one copy-on-write fault");
+  CHECK (hist_total (FAULT_COW) >= 1, "latency was recorded");
+  CHECK (faultstat (FAULTSTAT_ALL, FAULT_COW, -1)
+         >= faultstat (FAULTSTAT_SELF, FAULT_COW, -1),
+         "system count includes this process");
+  CHECK (faultstat (FAULTSTAT_SELF, FAULT_CLASS_CNT, -1) == -1,
+         "bad class is rejected");
+}
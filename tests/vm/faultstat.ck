@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(faultstat) begin
+(faultstat) read untouched page
+(faultstat) one zero-page fault
+(faultstat) one copy-on-write fault
+(faultstat) latency was recorded
+(faultstat) system count includes this process
+(faultstat) bad class is rejected
+(faultstat) end
+EOF
+pass;
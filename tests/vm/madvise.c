@@ -0,0 +1,42 @@
+/* Checks madvise(): MADV_WILLNEED loads an mmap'd page before it is
+   touched, MADV_DONTNEED makes anonymous pages read back as zeros, and
+   bad arguments are rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[2 * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  void *map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (actual, 4096, 0, handle, 0)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  CHECK (get_phys_addr (actual) == NULL, "mapped page is not loaded");
+  CHECK (madvise (actual, PAGE_SIZE, MADV_WILLNEED) == 0, "madvise WILLNEED");
+  CHECK (get_phys_addr (actual) != NULL, "mapped page is loaded");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+  munmap (map);
+  close (handle);
+
+  memset (buf, 'x', sizeof buf);
+  CHECK (madvise (buf, sizeof buf, MADV_DONTNEED) == 0, "madvise DONTNEED");
+  CHECK (buf[0] == 0 && buf[PAGE_SIZE + 1] == 0, "dropped pages read zero");
+
+  CHECK (madvise (buf + 1, PAGE_SIZE, MADV_DONTNEED) == -1,
+         "misaligned address is rejected");
+  CHECK (madvise (buf, PAGE_SIZE, 42) == -1, "unknown advice is rejected");
+  CHECK (madvise ((void *) 0x20000000, PAGE_SIZE, MADV_WILLNEED) == -1,
+         "unmapped range is rejected");
+}
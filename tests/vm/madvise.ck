@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise) begin
+(madvise) open "sample.txt"
+(madvise) mmap "sample.txt"
+(madvise) mapped page is not loaded
+(madvise) madvise WILLNEED
+(madvise) mapped page is loaded
+(madvise) madvise DONTNEED
+(madvise) dropped pages read zero
+(madvise) misaligned address is rejected
+(madvise) unknown advice is rejected
+(madvise) unmapped range is rejected
+(madvise) end
+EOF
+pass;
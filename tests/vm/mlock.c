@@ -0,0 +1,25 @@
+/* Checks that mlock() loads the pages of a range, that munlock()
+   undoes it, and that ranges that are not mapped are rejected. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[2 * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  CHECK (get_phys_addr (buf) == NULL, "pages are not loaded");
+  CHECK (mlock (buf + 100, PAGE_SIZE) == 0, "mlock");
+  CHECK (get_phys_addr (buf) != NULL
+         && get_phys_addr (buf + PAGE_SIZE) != NULL,
+         "both overlapped pages are loaded");
+  buf[0] = 'x';
+  CHECK (buf[0] == 'x' && buf[PAGE_SIZE] == 0, "locked pages are usable");
+  CHECK (munlock (buf + 100, PAGE_SIZE) == 0, "munlock");
+  CHECK (mlock ((void *) 0x20000000, PAGE_SIZE) == -1,
+         "unmapped range is rejected");
+}
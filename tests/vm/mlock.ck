@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mlock) begin
+(mlock) pages are not loaded
+(mlock) mlock
+(mlock) both overlapped pages are loaded
+(mlock) locked pages are usable
+(mlock) munlock
+(mlock) unmapped range is rejected
+(mlock) end
+EOF
+pass;
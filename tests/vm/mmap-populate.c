@@ -0,0 +1,28 @@
+/* Checks that MAP_POPULATE loads a mapping before it is touched, with
+   the right contents, and that unknown mmap flags are rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  void *map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap_flags (actual, 4096, 0, handle, 0, 0x80) == MAP_FAILED,
+         "unknown flag is rejected");
+  CHECK ((map = mmap_flags (actual, 4096, 0, handle, 0, MAP_POPULATE))
+         != MAP_FAILED, "mmap \"sample.txt\" with MAP_POPULATE");
+  CHECK (get_phys_addr (actual) != NULL, "page is loaded before any access");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-populate) begin
+(mmap-populate) open "sample.txt"
+(mmap-populate) unknown flag is rejected
+(mmap-populate) mmap "sample.txt" with MAP_POPULATE
+(mmap-populate) page is loaded before any access
+(mmap-populate) end
+EOF
+pass;
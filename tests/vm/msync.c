@@ -0,0 +1,46 @@
+/* Checks that msync(MS_SYNC) writes the dirty pages of a writable
+   mapping to the file while the mapping is still in place, and that
+   bad arguments are rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define FILE_SIZE (3 * PAGE_SIZE)
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle, check;
+  void *map;
+  size_t i;
+
+  CHECK (create ("msync.dat", FILE_SIZE), "create \"msync.dat\"");
+  CHECK ((handle = open ("msync.dat")) > 1, "open \"msync.dat\"");
+  CHECK ((map = mmap (actual, FILE_SIZE, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"msync.dat\"");
+
+  for (i = 0; i < FILE_SIZE; i++)
+    actual[i] = i % 251;
+  CHECK (msync (actual, FILE_SIZE, MS_SYNC) == 0, "msync");
+
+  CHECK ((check = open ("msync.dat")) > 1, "open \"msync.dat\" again");
+  CHECK (read (check, buf, FILE_SIZE) == FILE_SIZE, "read \"msync.dat\"");
+  if (memcmp (buf, actual, FILE_SIZE))
+    fail ("file does not match mapping after msync");
+  close (check);
+
+  CHECK (msync (actual, FILE_SIZE, MS_SYNC | MS_ASYNC) == -1,
+         "conflicting flags are rejected");
+  CHECK (msync (buf, PAGE_SIZE, MS_SYNC) == -1,
+         "range outside the mapping is rejected");
+  CHECK (msync (actual, FILE_SIZE, MS_ASYNC) == 0, "msync async");
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(msync) begin
+(msync) create "msync.dat"
+(msync) open "msync.dat"
+(msync) mmap "msync.dat"
+(msync) msync
+(msync) open "msync.dat" again
+(msync) read "msync.dat"
+(msync) conflicting flags are rejected
+(msync) range outside the mapping is rejected
+(msync) msync async
+(msync) end
+EOF
+pass;
@@ -0,0 +1,18 @@
+/* Loops over every page in order, a working set larger than
+   memory.  LRU and plain clock miss on every access. */
+
+#include "tests/vm/replace-trace.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static size_t
+next (size_t i)
+{
+  return i % TRACE_PAGES;
+}
+
+void
+test_main (void)
+{
+  replace_trace (3 * TRACE_PAGES, next);
+}
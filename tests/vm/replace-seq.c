@@ -0,0 +1,24 @@
+/* A hot set used over and over, interrupted by sequential scans
+   of pages that are used once each.  A scan-resistant policy keeps
+   the hot set in memory. */
+
+#include "tests/vm/replace-trace.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HOT_PAGES 1000
+#define SCAN_PAGES (TRACE_PAGES - HOT_PAGES)
+#define ROUND (2 * HOT_PAGES + SCAN_PAGES)
+
+static size_t
+next (size_t i)
+{
+  size_t ofs = i % ROUND;
+  return ofs < 2 * HOT_PAGES ? ofs % HOT_PAGES : ofs - HOT_PAGES;
+}
+
+void
+test_main (void)
+{
+  replace_trace (4 * ROUND, next);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my ($faults) = grep (/^\(replace-seq\) \d+ swap faults$/, @output);
+fail "no fault count reported\n" if !defined $faults;
+@output = grep ($_ ne $faults, @output);
+common_checks ("run", @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(replace-seq) begin
+(replace-seq) fill 3000 pages
+(replace-seq) run 16000 accesses
+(replace-seq) end
+EOF
+pass;
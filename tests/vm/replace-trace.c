@@ -0,0 +1,41 @@
+/* Runs an access trace over a region larger than memory and
+   reports how many pages had to be brought back in, so that the
+   page replacement policies ("-vmpolicy=NAME") can be compared.
+   Every page holds its own number, which is checked on each
+   access. */
+
+#include "tests/vm/replace-trace.h"
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char region[TRACE_PAGES * PAGE_SIZE];
+
+/* Writes each page once, then makes ACCESS_CNT accesses, the I'th
+   to page NEXT(I). */
+void
+replace_trace (size_t access_cnt, size_t (*next) (size_t i))
+{
+  long long faults;
+  size_t i;
+
+  msg ("fill %d pages", TRACE_PAGES);
+  for (i = 0; i < TRACE_PAGES; i++)
+    *(size_t *) (region + i * PAGE_SIZE) = i;
+
+  msg ("run %zu accesses", access_cnt);
+  faults = faultstat (FAULTSTAT_SELF, FAULT_SWAP, -1);
+  for (i = 0; i < access_cnt; i++)
+    {
+      size_t page = next (i);
+      if (*(size_t *) (region + page * PAGE_SIZE) != page)
+        fail ("page %zu is corrupted", page);
+    }
+  faults = faultstat (FAULTSTAT_SELF, FAULT_SWAP, -1) - faults;
+
+  /* Not part of the expected output: the count depends on the
+     policy and on the size of memory. */
+  msg ("%lld swap faults", faults);
+}
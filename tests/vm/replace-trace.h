@@ -0,0 +1,12 @@
+#ifndef TESTS_VM_REPLACE_TRACE
+#define TESTS_VM_REPLACE_TRACE 1
+
+#include <stddef.h>
+
+/* Pages in the traced region, about 1.3 times the user pool of a
+   20 MB machine. */
+#define TRACE_PAGES 3000
+
+void replace_trace (size_t access_cnt, size_t (*next) (size_t i));
+
+#endif /* tests/vm/replace-trace.h */
@@ -0,0 +1,48 @@
+/* Draws pages from a Zipf distribution with exponent 1: the page
+   of rank R is used in proportion to 1 / R.  Ranks are scattered
+   over the region so that hot pages are not neighbors. */
+
+#include <stdint.h>
+#include "tests/vm/replace-trace.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACCESS_CNT 20000
+#define WEIGHT 65536                    /* Weight of rank 1. */
+#define SCATTER 7919                    /* Prime, coprime to TRACE_PAGES. */
+
+static uint32_t cdf[TRACE_PAGES];       /* Cumulative rank weights. */
+static uint64_t seed = 0x5eed;
+
+static size_t
+next (size_t i UNUSED)
+{
+  uint32_t r;
+  size_t lo = 0, hi = TRACE_PAGES - 1;
+
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  r = (seed >> 33) % cdf[TRACE_PAGES - 1];
+  while (lo < hi)
+    {
+      size_t mid = (lo + hi) / 2;
+      if (cdf[mid] > r)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+  return lo * SCATTER % TRACE_PAGES;
+}
+
+void
+test_main (void)
+{
+  uint32_t sum = 0;
+  size_t rank;
+
+  for (rank = 0; rank < TRACE_PAGES; rank++)
+    {
+      sum += WEIGHT / (rank + 1);
+      cdf[rank] = sum;
+    }
+  replace_trace (ACCESS_CNT, next);
+}
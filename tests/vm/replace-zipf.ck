@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my ($faults) = grep (/^\(replace-zipf\) \d+ swap faults$/, @output);
+fail "no fault count reported\n" if !defined $faults;
+@output = grep ($_ ne $faults, @output);
+common_checks ("run", @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(replace-zipf) begin
+(replace-zipf) fill 3000 pages
+(replace-zipf) run 20000 accesses
+(replace-zipf) end
+EOF
+pass;
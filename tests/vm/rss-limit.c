@@ -0,0 +1,36 @@
+/* Checks that a process with a resident limit stays within it by
+   replacing its own pages, that the evictions are accounted to it
+   both as cause and as victim, and that the data survives. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define LIMIT 64
+#define PAGE_CNT (4 * LIMIT)
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  CHECK (rsslimit (LIMIT) == 0, "set limit to %d pages", LIMIT);
+  CHECK (rssstat (RSS_LIMIT) == LIMIT, "limit reads back");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i;
+  CHECK (rssstat (RSS_PAGES) <= LIMIT, "resident set is within the limit");
+  CHECK (rssstat (RSS_EVICT_CAUSED) > 0, "process evicted pages");
+  CHECK (rssstat (RSS_EVICT_SUFFERED) > 0, "its own pages were evicted");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (buf[i * PAGE_SIZE] != (char) i)
+      fail ("page %zu is corrupted", i);
+  msg ("data is intact");
+
+  CHECK (rsslimit (0) == LIMIT, "remove limit");
+  CHECK (rssstat (-1) == -1, "bad field is rejected");
+}
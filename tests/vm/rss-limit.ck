@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-limit) begin
+(rss-limit) set limit to 64 pages
+(rss-limit) limit reads back
+(rss-limit) resident set is within the limit
+(rss-limit) process evicted pages
+(rss-limit) its own pages were evicted
+(rss-limit) data is intact
+(rss-limit) remove limit
+(rss-limit) bad field is rejected
+(rss-limit) end
+EOF
+pass;
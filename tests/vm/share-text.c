@@ -0,0 +1,29 @@
+/* Checks that a forked child maps the same frame as its parent for
+   a page of read-only executable text, instead of reading its own
+   copy of it. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_MASK ((uintptr_t) 4096 - 1)
+
+void
+test_main (void)
+{
+  /* This page is being executed, so it is loaded. */
+  void *code = (void *) ((uintptr_t) test_main & ~PAGE_MASK);
+  void *pa = get_phys_addr (code);
+  int pid;
+
+  CHECK (pa != NULL, "text page is loaded");
+  if ((pid = fork ("child"))) {
+    wait (pid);
+    CHECK (get_phys_addr (code) == pa, "parent still maps the same frame");
+  } else {
+    /* Returning from fork() ran this page in the child. */
+    CHECK (get_phys_addr (code) == pa, "child shares the text frame");
+    exit (0);
+  }
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(share-text) begin
+(share-text) text page is loaded
+(share-text) child shares the text frame
+(share-text) parent still maps the same frame
+(share-text) end
+EOF
+pass;
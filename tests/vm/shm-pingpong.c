@@ -0,0 +1,111 @@
+/* Passes messages back and forth between a parent and its forked
+   child through a shared memory segment, checking each one, and
+   reports the bandwidth.  Also checks that both processes map the
+   same frame and that bad requests are rejected. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define MSG_SIZE (4 * PAGE_SIZE)
+#define ROUNDS 32
+#define SHM_ADDR ((void *) 0x10000000)
+
+struct channel
+  {
+    volatile int turn;          /* 1: child's turn to read, 0: parent's. */
+    char data[MSG_SIZE];
+  };
+
+/* Keeps the compiler from moving message stores past TURN. */
+#define barrier() asm volatile ("" : : : "memory")
+
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+static void
+fill (struct channel *ch, int seed)
+{
+  size_t i;
+
+  for (i = 0; i < MSG_SIZE; i++)
+    ch->data[i] = seed + i;
+}
+
+static void
+verify (struct channel *ch, int seed, int round)
+{
+  size_t i;
+
+  for (i = 0; i < MSG_SIZE; i++)
+    if (ch->data[i] != (char) (seed + i))
+      fail ("message %d is corrupted at byte %zu", round, i);
+}
+
+static void
+child (struct channel *ch, void *pa)
+{
+  int r;
+
+  for (r = 0; r < ROUNDS; r++)
+    {
+      while (ch->turn != 1)
+        continue;
+      barrier ();
+      if (r == 0)
+        CHECK (get_phys_addr (ch) == pa, "child maps the parent's frame");
+      verify (ch, r, r);
+      fill (ch, ~r);
+      barrier ();
+      ch->turn = 0;
+    }
+  exit (0);
+}
+
+void
+test_main (void)
+{
+  struct channel *ch;
+  uint64_t start, cycles;
+  void *pa;
+  int id, pid, r;
+
+  CHECK (shmget (SHM_PRIVATE, 0) == -1, "empty segment is rejected");
+  CHECK ((id = shmget (SHM_PRIVATE, sizeof *ch)) >= 0, "create segment");
+  CHECK (shmat (id, (char *) SHM_ADDR + 1) == NULL,
+         "misaligned attach is rejected");
+  CHECK ((ch = shmat (id, SHM_ADDR)) == SHM_ADDR, "attach segment");
+
+  ch->turn = 0;
+  pa = get_phys_addr (ch);
+  if ((pid = fork ("child")) == 0)
+    child (ch, pa);
+
+  start = rdtsc ();
+  for (r = 0; r < ROUNDS; r++)
+    {
+      fill (ch, r);
+      barrier ();
+      ch->turn = 1;
+      while (ch->turn != 0)
+        continue;
+      barrier ();
+      verify (ch, ~r, r);
+    }
+  cycles = rdtsc () - start;
+  CHECK (wait (pid) == 0, "exchanged %d messages", ROUNDS);
+
+  /* Not part of the expected output: depends on the machine and on
+     how often the scheduler switches between the two processes. */
+  msg ("%d bytes in %llu cycles", 2 * ROUNDS * MSG_SIZE, cycles);
+
+  CHECK (shmdt (SHM_ADDR) == 0, "detach segment");
+  CHECK (shmdt (SHM_ADDR) == -1, "detach twice is rejected");
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my ($bw) = grep (/^\(shm-pingpong\) \d+ bytes in \d+ cycles$/, @output);
+fail "no bandwidth reported\n" if !defined $bw;
+@output = grep ($_ ne $bw, @output);
+common_checks ("run", @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(shm-pingpong) begin
+(shm-pingpong) empty segment is rejected
+(shm-pingpong) create segment
+(shm-pingpong) misaligned attach is rejected
+(shm-pingpong) attach segment
+(shm-pingpong) child maps the parent's frame
+(shm-pingpong) exchanged 32 messages
+(shm-pingpong) detach segment
+(shm-pingpong) detach twice is rejected
+(shm-pingpong) end
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Reads a bss page, which maps the shared zero frame, and then has
+   read() fill it from a file.  The kernel's write must give the page a
+   private frame, so child-zero, run afterwards, still reads zeros from
+   its own bss. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+/* Page aligned so that no page of it shares initialized data. */
+static char buf[PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  size_t size = sizeof sample - 1;
+  int handle;
+  pid_t child;
+
+  CHECK (buf[0] == 0, "bss page reads zero");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, size) == (int) size,
+         "read \"sample.txt\" into bss page");
+  if (memcmp (buf, sample, size))
+    fail ("read of \"sample.txt\" reported bad data");
+  close (handle);
+
+  child = fork ("child-zero");
+  if (child == 0) {
+    if (exec ("child-zero") == -1)
+      fail ("failed to exec child-zero");
+  }
+  CHECK (wait (child) == 0x42, "child-zero reads zeros from its bss");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-page-read) begin
+(zero-page-read) bss page reads zero
+(zero-page-read) open "sample.txt"
+(zero-page-read) read "sample.txt" into bss page
+(zero-page-read) child-zero reads zeros from its bss
+(zero-page-read) end
+EOF
+pass;
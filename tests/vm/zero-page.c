@@ -0,0 +1,39 @@
+/* Checks that reading untouched anonymous pages maps them all to a
+   single shared frame of zeros, and that writing one of them gives it
+   a private frame without disturbing the others. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 4
+
+/* Page aligned so that no page of it shares initialized data. */
+static char buf[PAGE_COUNT * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  void *zero;
+  size_t i;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    if (buf[i * PAGE_SIZE] != 0)
+      fail ("page %zu is not zero", i);
+
+  zero = get_phys_addr (&buf[0]);
+  CHECK (zero != NULL, "read pages are mapped");
+  for (i = 1; i < PAGE_COUNT; i++)
+    if (get_phys_addr (&buf[i * PAGE_SIZE]) != zero)
+      fail ("page %zu does not map the zero frame", i);
+
+  buf[PAGE_SIZE] = 'x';
+  CHECK (get_phys_addr (&buf[PAGE_SIZE]) != zero,
+         "written page has its own frame");
+  CHECK (buf[PAGE_SIZE] == 'x' && buf[PAGE_SIZE + 1] == 0,
+         "written page keeps the write");
+  CHECK (get_phys_addr (&buf[0]) == zero && buf[0] == 0,
+         "other pages still read zero");
+}
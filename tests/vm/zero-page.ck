@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-page) begin
+(zero-page) read pages are mapped
+(zero-page) written page has its own frame
+(zero-page) written page keeps the write
+(zero-page) other pages still read zero
+(zero-page) end
+EOF
+pass;
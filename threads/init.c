@@ -31,11 +31,16 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
+#include "vm/faultstat.h"
+#include "vm/replace.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/fat.h"
 #include "filesys/fsutil.h"
+#include "filesys/page_cache.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -152,19 +157,34 @@ paging_init (uint64_t mem_end) {
 	extern char start, _end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	// Whole 2 MB chunks are mapped with one huge page each.  The first
+	// chunk (legacy memory below 1 MB) and the chunks holding the
+	// read-only kernel text use 4 kB pages.  KERN_BASE is not 1 GB
+	// aligned, so 1 GB pages cannot be used for this map.
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
+		if (pa != 0 && pa % HUGE_PGSIZE == 0 && pa + HUGE_PGSIZE <= mem_end
+				&& (va + HUGE_PGSIZE <= (uint64_t) &start
+					|| va >= (uint64_t) &_end_kernel_text)) {
+			if ((pte = pml4e_walk_pde (pml4, va, 1)) != NULL)
+				*pte = pa | PTE_P | PTE_W | PTE_PS;
+			pa += HUGE_PGSIZE;
+			continue;
+		}
+
 		perm = PTE_P | PTE_W;
 		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
 	pml4_activate(0);
+	pcid_init ();
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -216,16 +236,40 @@ parse_options (char **argv) {
 #ifdef FILESYS
 		else if (!strcmp (name, "-f"))
 			format_filesys = true;
+		else if (!strcmp (name, "-fs-flush"))
+			page_cache_flush_ticks = atoi (value);
+		else if (!strcmp (name, "-fs-cluster"))
+			fat_format_cluster_sectors = atoi (value);
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-no-pcid"))
+			pcid_allowed = false;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-zswap"))
+			zswap_pool_pages = atoi (value);
+		else if (!strcmp (name, "-fa"))
+			fault_around_pages = atoi (value);
+		else if (!strcmp (name, "-no-fa-mmap"))
+			fault_around_mmap = false;
+		else if (!strcmp (name, "-hugepages"))
+			vm_hugepages = true;
+		else if (!strcmp (name, "-mlock"))
+			mlock_limit = atoi (value);
+		else if (!strcmp (name, "-mmap-flush"))
+			mmap_flush_ticks = atoi (value);
+		else if (!strcmp (name, "-vmpolicy"))
+			replace_policy_name = value;
+		else if (!strcmp (name, "-rss-limit"))
+			rss_default_limit = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -268,6 +312,7 @@ run_actions (char **argv) {
 		{"run", 2, run_task},
 #ifdef FILESYS
 		{"ls", 1, fsutil_ls},
+		{"frag", 1, fsutil_frag},
 		{"cat", 2, fsutil_cat},
 		{"rm", 2, fsutil_rm},
 		{"put", 2, fsutil_put},
@@ -314,6 +359,7 @@ usage (void) {
 #endif
 #ifdef FILESYS
 			"  ls                 List files in the root directory.\n"
+			"  frag               Report how fragmented those files are.\n"
 			"  cat FILE           Print FILE to the console.\n"
 			"  rm FILE            Delete FILE.\n"
 			"Use these actions indirectly via `pintos' -g and -p options:\n"
@@ -324,10 +370,25 @@ usage (void) {
 			"  -h                 Print this help message and power off.\n"
 			"  -q                 Power off VM after actions or on panic.\n"
 			"  -f                 Format file system disk during startup.\n"
+#ifdef FILESYS
+			"  -fs-flush=TICKS    Write back file data dirty for TICKS (0=off).\n"
+			"  -fs-cluster=SECS   Format with SECS sectors per cluster (1..64).\n"
+#endif
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -no-pcid           Do not tag TLB entries with PCIDs.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -zswap=PAGES       Use PAGES pages for compressed swap (0=off).\n"
+			"  -fa=N              Map up to N pages around file-backed faults.\n"
+			"  -no-fa-mmap        Do not fault around mmap regions.\n"
+			"  -hugepages         Use 2 MB pages for large anonymous regions.\n"
+			"  -mlock=PAGES       Allow at most PAGES pages to be mlock()ed.\n"
+			"  -mmap-flush=TICKS  Write back dirty mmap pages every TICKS (0=off).\n"
+			"  -vmpolicy=NAME     Replace pages with clock, clock2, clockpro or arc.\n"
+			"  -rss-limit=PAGES   Keep each process within PAGES frames (0=off).\n"
 #endif
 			);
 	power_off ();
@@ -362,4 +423,8 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	zswap_print_stats ();
+	faultstat_print ();
+#endif
 }
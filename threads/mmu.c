@@ -2,16 +2,44 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* Replaces the huge page mapping in *PDE with a page table that maps the
+ * same frames with 4 kB pages and the same permissions.  The translations
+ * do not change, so a stale TLB entry for the huge page stays correct
+ * until one of the new PTEs is modified and flushed. */
+static bool
+split_huge_pde (uint64_t *pde) {
+	uint64_t *pt = palloc_get_page (0);
+	if (pt == NULL)
+		return false;
+
+	uint64_t pa = PTE_ADDR (*pde);
+	uint64_t flags = *pde & PTE_FLAGS & ~PTE_PS;
+	for (unsigned i = 0; i < HUGE_PGCNT; i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	return true;
+}
+
+/* Returns the page table entry for VA in page directory PDP.  A huge page
+ * mapping is split into a page table when CREATE is set; otherwise its
+ * page directory entry, which has the same A/D/W bits, is returned. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
+		if (pdp[idx] & PTE_PS) {
+			if (!create)
+				return &pdp[idx];
+			if (!split_huge_pde (&pdp[idx]))
+				return NULL;
+		}
 		uint64_t *pte = (uint64_t *) pdp[idx];
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
@@ -88,6 +116,131 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the page directory entry for virtual address VA in PML4E,
+ * creating the upper levels if CREATE is true, or a null pointer. */
+uint64_t *
+pml4e_walk_pde (uint64_t *pml4e, const uint64_t va, int create) {
+	uint64_t *table = pml4e;
+	int idx[] = { PML4 (va), PDPE (va) };
+
+	for (unsigned i = 0; i < sizeof idx / sizeof *idx; i++) {
+		if (!(table[idx[i]] & PTE_P)) {
+			if (!create)
+				return NULL;
+			uint64_t *new_page = palloc_get_page (PAL_ZERO);
+			if (new_page == NULL)
+				return NULL;
+			table[idx[i]] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (table[idx[i]]));
+	}
+	return &table[PDX (va)];
+}
+
+/* Process-context identifiers.  With CR4.PCIDE set, the low 12 bits of
+ * CR3 tag every TLB entry with the address space that loaded it, and a
+ * CR3 load with CR3_NOFLUSH keeps the entries of all other PCIDs, so a
+ * process that runs again finds its translations still cached.
+ * base_pml4 owns PCID 0.  A user pml4 keeps its PCID in the PML4 slot
+ * PCID_SLOT, which is never present: user addresses live in slot 0 and
+ * the kernel in slot 1. */
+#define CR3_NOFLUSH (1ULL << 63)
+#define CR3_PCID 0xfffULL
+#define CR4_PCIDE (1 << 17)
+#define CPUID_PCID (1 << 17)            /* CPUID.01H:ECX. */
+#define CPUID_INVPCID (1 << 10)         /* CPUID.(07H,0):EBX. */
+#define INVPCID_ADDR 0
+#define INVPCID_CONTEXT 1
+
+#define PCID_CNT 4096
+#define PCID_SLOT (PGSIZE / sizeof (uint64_t) - 1)
+#define PCID_SHIFT 12
+#define PCID_STALE 0x2                  /* Flush the PCID on next load. */
+#define slot_pcid(SLOT) (((SLOT) >> PCID_SHIFT) & CR3_PCID)
+
+/* Cleared by the "-no-pcid" kernel option. */
+bool pcid_allowed = true;
+
+static bool pcid_enabled;
+static bool invpcid_enabled;
+static uint64_t pcid_used[PCID_CNT / 64];
+
+/* Turns on PCIDs if the CPU has them.  Must be called with base_pml4
+ * loaded, since CR4.PCIDE can only be set while the current PCID is 0. */
+void
+pcid_init (void) {
+	uint32_t regs[4];
+
+	cpuid (0, 0, regs);
+	uint32_t max_leaf = regs[0];
+	cpuid (1, 0, regs);
+	if (!pcid_allowed || !(regs[2] & CPUID_PCID))
+		return;
+	if (max_leaf >= 7) {
+		cpuid (7, 0, regs);
+		invpcid_enabled = (regs[1] & CPUID_INVPCID) != 0;
+	}
+
+	ASSERT ((rcr3 () & CR3_PCID) == 0);
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_used[0] = 1;
+	pcid_enabled = true;
+}
+
+/* Returns a free PCID, or 0 if all are taken.  A pml4 that gets 0
+ * shares it with base_pml4 and is flushed on every load instead. */
+static uint64_t
+pcid_alloc (void) {
+	enum intr_level old_level = intr_disable ();
+	uint64_t pcid = 0;
+	for (unsigned i = 0; i < PCID_CNT / 64; i++)
+		if (~pcid_used[i] != 0) {
+			int bit = __builtin_ctzll (~pcid_used[i]);
+			pcid_used[i] |= 1ULL << bit;
+			pcid = i * 64 + bit;
+			break;
+		}
+	intr_set_level (old_level);
+	return pcid;
+}
+
+static void
+pcid_free (uint64_t pcid) {
+	enum intr_level old_level = intr_disable ();
+	if (pcid != 0)
+		pcid_used[pcid / 64] &= ~(1ULL << (pcid % 64));
+	intr_set_level (old_level);
+}
+
+/* Returns true if PML4 is the page table CR3 points to.  A kernel
+ * thread keeps the page table of the process that ran before it, so
+ * this is not the same as PML4 belonging to the running thread. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return (rcr3 () & ~CR3_PCID) == vtop (pml4);
+}
+
+/* Drops the TLB entry for VA after its PTE in PML4 was changed.  The
+ * entry is cached under PML4's PCID even when PML4 is not loaded; it is
+ * invalidated with INVPCID if the CPU has it, and otherwise PML4 flushes
+ * its whole PCID the next time it is loaded.  Called with interrupts
+ * off, together with the PTE update, so that the owner of PML4 cannot
+ * run in between and reload the old translation. */
+static void
+tlb_flush_page (uint64_t *pml4, const void *va) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (pml4_is_active (pml4))
+		invlpg ((uint64_t) va);
+	else if (pcid_enabled) {
+		uint64_t pcid = slot_pcid (pml4[PCID_SLOT]);
+		if (invpcid_enabled && pcid != 0)
+			invpcid (INVPCID_ADDR, pcid, (uint64_t) va);
+		else
+			pml4[PCID_SLOT] |= PCID_STALE;
+	}
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -95,8 +248,18 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 uint64_t *
 pml4_create (void) {
 	uint64_t *pml4 = palloc_get_page (0);
-	if (pml4)
+	if (pml4) {
 		memcpy (pml4, base_pml4, PGSIZE);
+		pml4[PCID_SLOT] = 0;
+		if (pcid_enabled) {
+			/* The PCID may still have entries of a destroyed pml4
+			 * unless INVPCID dropped them at the time. */
+			uint64_t pcid = pcid_alloc ();
+			pml4[PCID_SLOT] = pcid << PCID_SHIFT;
+			if (!invpcid_enabled || pcid == 0)
+				pml4[PCID_SLOT] |= PCID_STALE;
+		}
+	}
 	return pml4;
 }
 
@@ -122,10 +285,17 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
-			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
-					pml4_index, pdp_index, i))
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		if (pdp[i] & PTE_PS) {
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
 				return false;
+		} else if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
+					pml4_index, pdp_index, i))
+			return false;
 	}
 	return true;
 }
@@ -169,7 +339,11 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (!(((uint64_t) pte) & PTE_P))
+			continue;
+		if (pdp[i] & PTE_PS)
+			palloc_free_multiple ((void *) PTE_ADDR (pte), HUGE_PGCNT);
+		else
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -192,18 +366,42 @@ pml4_destroy (uint64_t *pml4) {
 		return;
 	ASSERT (pml4 != base_pml4);
 
+	ASSERT (!pml4_is_active (pml4));
+
 	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+
+	uint64_t pcid = slot_pcid (pml4[PCID_SLOT]);
+	if (invpcid_enabled && pcid != 0)
+		invpcid (INVPCID_CONTEXT, pcid, 0);
+	pcid_free (pcid);
 	palloc_free_page ((void *) pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  Nothing is done if PD is already loaded and not marked
+ * stale.  With PCIDs the load keeps the TLB, unless PD's own PCID was
+ * marked stale. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+
+	uint64_t cr3 = vtop (pml4);
+	uint64_t slot = pml4 != base_pml4 ? pml4[PCID_SLOT] : 0;
+	if (pcid_enabled)
+		cr3 |= slot_pcid (slot);
+	if (slot & PCID_STALE) {
+		/* A load without CR3_NOFLUSH drops the entries of its PCID. */
+		if (!pcid_enabled || slot_pcid (slot) != 0)
+			pml4[PCID_SLOT] = slot & ~PCID_STALE;
+	} else if (rcr3 () == cr3)
+		return;
+	else if (pcid_enabled)
+		cr3 |= CR3_NOFLUSH;
+	lcr3 (cr3);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -216,8 +414,12 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
-	if (pte && (*pte & PTE_P))
+	if (pte && (*pte & PTE_P)) {
+		if (*pte & PTE_PS)
+			return ptov (PTE_ADDR (*pte))
+				+ ((uint64_t) uaddr & (HUGE_PGSIZE - 1));
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+	}
 	return NULL;
 }
 
@@ -243,6 +445,42 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	return pte != NULL;
 }
 
+/* Maps the 2 MB-aligned user region at UPAGE to the HUGE_PGCNT
+ * contiguous frames at kernel virtual address KPAGE, which should come
+ * from palloc_get_huge_page(), with a single page directory entry.
+ * Fails if any page in the region is already mapped or if memory
+ * allocation fails. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (huge_round_down (upage) == upage);
+	ASSERT (huge_round_down (kpage) == kpage);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pml4e_walk_pde (pml4, (uint64_t) upage, 1);
+	if (pde == NULL)
+		return false;
+
+	if (*pde & PTE_P) {
+		/* An empty page table left behind by earlier mappings can go. */
+		uint64_t *pt;
+		if (*pde & PTE_PS)
+			return false;
+		pt = ptov (PTE_ADDR (*pde));
+		for (unsigned i = 0; i < PGSIZE / sizeof *pt; i++)
+			if (pt[i] & PTE_P)
+				return false;
+		/* INVLPG also drops the cached pointer to PT. */
+		enum intr_level old_level = intr_disable ();
+		*pde = 0;
+		tlb_flush_page (pml4, upage);
+		intr_set_level (old_level);
+		palloc_free_page (pt);
+	}
+	*pde = vtop (kpage) | PTE_P | PTE_PS | (rw ? PTE_W : 0) | PTE_U;
+	return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -253,12 +491,18 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (is_user_vaddr (upage));
 
+	/* Only part of a huge page goes away: split it first. */
+	pte = pml4e_walk_pde (pml4, (uint64_t) upage, false);
+	if (pte != NULL && (*pte & PTE_PS) && !split_huge_pde (pte))
+		PANIC ("pml4_clear_page: cannot split huge page");
+
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
+		enum intr_level old_level = intr_disable ();
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_flush_page (pml4, upage);
+		intr_set_level (old_level);
 	}
 }
 
@@ -278,16 +522,34 @@ void
 pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
+		enum intr_level old_level = intr_disable ();
 		if (dirty)
 			*pte |= PTE_D;
 		else
 			*pte &= ~(uint32_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_flush_page (pml4, vpage);
+		intr_set_level (old_level);
 	}
 }
 
+/* Clears the dirty bit in the PTE for virtual page VPAGE in PML4 and
+ * returns whether it was set.  The bit is cleared with a single locked
+ * instruction, so a write that sets it concurrently is never lost. */
+bool
+pml4_test_and_clear_dirty (uint64_t *pml4, const void *vpage) {
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	if (pte == NULL || (*pte & PTE_D) == 0)
+		return false;
+
+	enum intr_level old_level = intr_disable ();
+	uint64_t old = __atomic_fetch_and (pte, ~(uint64_t) PTE_D,
+			__ATOMIC_SEQ_CST);
+	tlb_flush_page (pml4, vpage);
+	intr_set_level (old_level);
+	return (old & PTE_D) != 0;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PML4 has been
  * accessed recently, that is, between the time the PTE was
  * installed and the last time it was cleared.  Returns false if
@@ -304,12 +566,135 @@ void
 pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
+		enum intr_level old_level = intr_disable ();
 		if (accessed)
 			*pte |= PTE_A;
 		else
 			*pte &= ~(uint32_t) PTE_A;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_flush_page (pml4, vpage);
+		intr_set_level (old_level);
+	}
+}
+
+/* Batched TLB invalidation.  mmu_gather_clear_page() takes a page out of
+ * the page table like pml4_clear_page() but only records it, and
+ * mmu_gather_finish() invalidates all recorded pages at once.  In
+ * between, the old translations may still be cached, so the caller must
+ * not hand out the frames behind them before the finish. */
+void
+mmu_gather_init (struct mmu_gather *tlb, uint64_t *pml4) {
+	tlb->pml4 = pml4;
+	tlb->page_cnt = 0;
+	tlb->flush_all = false;
+	tlb->table_cnt = 0;
+}
+
+/* Records that the translation for UPAGE must be invalidated. */
+static void
+mmu_gather_add (struct mmu_gather *tlb, void *upage) {
+	if (tlb->page_cnt < MMU_GATHER_PAGES)
+		tlb->pages[tlb->page_cnt++] = upage;
+	else
+		tlb->flush_all = true;
+}
+
+/* Invalidates everything recorded in TLB and frees the queued page
+ * tables. */
+static void
+mmu_gather_flush (struct mmu_gather *tlb) {
+	uint64_t *pml4 = tlb->pml4;
+	enum intr_level old_level = intr_disable ();
+
+	if (pml4_is_active (pml4)) {
+		if (tlb->flush_all)
+			lcr3 (rcr3 ());
+		else
+			for (size_t i = 0; i < tlb->page_cnt; i++)
+				invlpg ((uint64_t) tlb->pages[i]);
+	} else if (pcid_enabled && tlb->page_cnt != 0) {
+		uint64_t pcid = slot_pcid (pml4[PCID_SLOT]);
+		if (!invpcid_enabled || pcid == 0)
+			pml4[PCID_SLOT] |= PCID_STALE;
+		else if (tlb->flush_all)
+			invpcid (INVPCID_CONTEXT, pcid, 0);
+		else
+			for (size_t i = 0; i < tlb->page_cnt; i++)
+				invpcid (INVPCID_ADDR, pcid, (uint64_t) tlb->pages[i]);
 	}
+	intr_set_level (old_level);
+
+	/* Every invalidation above also drops the cached upper-level
+	 * entries of the address space, which may point to these. */
+	for (size_t i = 0; i < tlb->table_cnt; i++)
+		palloc_free_page (tlb->tables[i]);
+	tlb->page_cnt = 0;
+	tlb->flush_all = false;
+	tlb->table_cnt = 0;
+}
+
+/* Marks user virtual page UPAGE "not present" in TLB's page table, as
+ * pml4_clear_page() does, and defers the invalidation. */
+void
+mmu_gather_clear_page (struct mmu_gather *tlb, void *upage) {
+	uint64_t *pml4 = tlb->pml4;
+	uint64_t *pte;
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	pte = pml4e_walk_pde (pml4, (uint64_t) upage, false);
+	if (pte != NULL && (*pte & PTE_PS) && !split_huge_pde (pte))
+		PANIC ("mmu_gather_clear_page: cannot split huge page");
+
+	pte = pml4e_walk (pml4, (uint64_t) upage, false);
+	if (pte == NULL || (*pte & PTE_P) == 0)
+		return;
+
+	/* The owner of someone else's page table may run before the
+	 * flush; have it drop its TLB when it does. */
+	enum intr_level old_level = intr_disable ();
+	*pte &= ~PTE_P;
+	if (thread_current ()->pml4 != pml4)
+		pml4[PCID_SLOT] |= PCID_STALE;
+	intr_set_level (old_level);
+	mmu_gather_add (tlb, upage);
+}
+
+/* Unlinks the page tables that cover only addresses from START to END
+ * and map nothing, to be freed by the next flush. */
+void
+mmu_gather_free_tables (struct mmu_gather *tlb, void *start, void *end) {
+	uint64_t *pml4 = tlb->pml4;
+	uint8_t *va = huge_round_down ((uint8_t *) start + HUGE_PGSIZE - 1);
+
+	for (; va + HUGE_PGSIZE <= (uint8_t *) end; va += HUGE_PGSIZE) {
+		uint64_t *pde = pml4e_walk_pde (pml4, (uint64_t) va, false);
+		if (pde == NULL || (*pde & PTE_P) == 0 || (*pde & PTE_PS))
+			continue;
+
+		uint64_t *pt = ptov (PTE_ADDR (*pde));
+		size_t i;
+		for (i = 0; i < PGSIZE / sizeof *pt; i++)
+			if (pt[i] & PTE_P)
+				break;
+		if (i < PGSIZE / sizeof *pt)
+			continue;
+
+		if (tlb->table_cnt == MMU_GATHER_TABLES)
+			mmu_gather_flush (tlb);
+		enum intr_level old_level = intr_disable ();
+		*pde = 0;
+		if (thread_current ()->pml4 != pml4)
+			pml4[PCID_SLOT] |= PCID_STALE;
+		intr_set_level (old_level);
+		tlb->tables[tlb->table_cnt++] = pt;
+		mmu_gather_add (tlb, va);
+	}
+}
+
+/* Invalidates the TLB entries of every page cleared through TLB and
+ * frees the page tables it collected. */
+void
+mmu_gather_finish (struct mmu_gather *tlb) {
+	mmu_gather_flush (tlb);
 }
@@ -9,6 +9,7 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/loader.h"
+#include "threads/pte.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -284,6 +285,37 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Obtains HUGE_PGCNT contiguous free pages that start on a 2 MB
+   boundary, so that they can be mapped with one huge page, and
+   returns the kernel virtual address of the first one.  FLAGS are
+   as for palloc_get_multiple(). */
+void *
+palloc_get_huge_page (enum palloc_flags flags) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t page_cnt = bitmap_size (pool->used_map);
+	size_t page_idx = (HUGE_PGSIZE - (uint64_t) pool->base % HUGE_PGSIZE)
+		% HUGE_PGSIZE / PGSIZE;
+	void *pages = NULL;
+
+	lock_acquire (&pool->lock);
+	for (; page_idx + HUGE_PGCNT <= page_cnt; page_idx += HUGE_PGCNT)
+		if (bitmap_none (pool->used_map, page_idx, HUGE_PGCNT)) {
+			bitmap_set_multiple (pool->used_map, page_idx, HUGE_PGCNT, true);
+			pages = pool->base + PGSIZE * page_idx;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (pages) {
+		if (flags & PAL_ZERO)
+			memset (pages, 0, HUGE_PGSIZE);
+	} else {
+		if (flags & PAL_ASSERT)
+			PANIC ("palloc_get: out of huge pages");
+	}
+	return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -20,6 +20,8 @@
 #include "intrinsic.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/replace.h"
+#include "vm/faultstat.h"
 #endif
 
 static void process_cleanup (void);
@@ -66,6 +68,7 @@ static void
 initd (void *f_name) {
 #ifdef VM
 	supplemental_page_table_init (&thread_current ()->spt);
+	rss_set_limit (thread_current (), rss_default_limit);
 #endif
 
 	// process_init ();
@@ -184,6 +187,9 @@ __do_fork (void *aux) {
 	supplemental_page_table_init (&current->spt);
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
+	/* Inherited only now, so that copying never evicts the child's own
+	 * pages. */
+	rss_set_limit (current, parent->rss_limit);
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 		goto error;
@@ -255,6 +261,9 @@ process_exec (void *f_name) {
 	bool success;
 	char copy[128];
 	memcpy(copy,file_name,strlen(file_name) + 1);
+#ifdef VM
+	faultstat_exec_start ();
+#endif
 
 	/* We cannot use the intr_frame in the thread structure.
 	 * This is because when current thread rescheduled,
@@ -324,8 +333,9 @@ process_exit (void) {
 		close(i);
 	}
 	palloc_free_multiple(curr->fd_table,FDT_PAGES);
-	file_close(curr->running);
+	// 실행 파일의 page들이 모두 정리된 뒤에 실행 파일을 닫는다.
 	process_cleanup ();//추후 실험 필요
+	file_close(curr->running);
 	sema_up(&curr->wait_sema);
 	/* project4 추가 */
 	#ifdef EFILESYS
@@ -340,7 +350,7 @@ process_cleanup (void) {
 	struct thread *curr = thread_current ();
 
 #ifdef VM
-	if(!hash_empty(&curr->spt.spt_hash)){
+	if(curr->spt.vma_cnt != 0){
 		supplemental_page_table_kill (&curr->spt); // cleanup
 	}
 	// supplemental_page_table_kill (&curr->spt);
@@ -368,8 +378,11 @@ process_cleanup (void) {
  * This function is called on every context switch. */
 void
 process_activate (struct thread *next) {
-	/* Activate thread's page tables. */
-	pml4_activate (next->pml4);
+	/* Activate thread's page tables.  A kernel thread never touches
+	 * user memory, so it keeps whatever page table is loaded; switching
+	 * back to that process then costs no CR3 load at all. */
+	if (next->pml4 != NULL)
+		pml4_activate (next->pml4);
 
 	/* Set thread's kernel stack for use in processing interrupts. */
 	tss_update (next);
@@ -768,17 +781,14 @@ lazy_load_segment (struct page *page, void *aux) {
 	size_t read_bytes = ((struct container*)aux)->read_bytes;
 	size_t size_for_zero = PGSIZE - read_bytes;
 
-	file_seek(file,offset);
-	//file_read(file,buffer,size)
-	if(file_read(file,page->frame->kva,read_bytes) != (int)read_bytes){
+	// file_read_at은 파일 포지션을 건드리지 않으므로 seek/복원이 필요 없다.
+	if(file_read_at(file,page->frame->kva,read_bytes,offset) != (int)read_bytes){
 		palloc_free_page(page->frame->kva);
 		return false;
 	}
 	// 나머지 0을 채우는 용도
 	memset(page->frame->kva + read_bytes,0,size_for_zero);
 
-	file_seek(file,offset);//다시 offset 초기화
-
 	return true;
 }
 
@@ -822,7 +832,13 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
         container->offset = ofs;
 		container->read_bytes = page_read_bytes;
 
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
+		/* Read-only pages that come from the file are shared with other
+		 * processes running the same executable. */
+		enum vm_type type = VM_ANON;
+		if (!writable && page_read_bytes > 0)
+			type |= VM_TEXT;
+
+		if (!vm_alloc_page_with_initializer (type, upage,
 					writable, lazy_load_segment, container))
 			return false;
 
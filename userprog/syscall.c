@@ -14,6 +14,8 @@
 #include "lib/string.h"
 #include "threads/palloc.h"
 #include "vm/vm.h"
+#include "vm/faultstat.h"
+#include "vm/replace.h"
 #include "filesys/directory.h"
 #include "filesys/inode.h"
 
@@ -37,8 +39,15 @@ unsigned tell (int fd);
 int add_file(struct file *file);
 int dup2(int oldfd, int newfd);
 void remove_file(int fd);
-void * mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void * mmap (void *addr, size_t length, int writable, int fd, off_t offset, int flags);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+int mlock (void *addr, size_t length);
+int munlock (void *addr, size_t length);
+int msync (void *addr, size_t length, int flags);
+int rsslimit (int pages);
+int fallocate (int fd, off_t offset, off_t len);
+int fsync (int fd);
 void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write);
 struct page* check_address(void *addr);
 bool chdir(const char *path_name);
@@ -83,6 +92,7 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	// TODO: Your implementation goes here.
 	uint64_t number = f->R.rax;
 	thread_current()->rsp_stack = f->rsp;
+	faultstat_exec_main ();
 	switch (number)
 	{
 	case SYS_HALT:
@@ -133,11 +143,47 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		f->R.rax = dup2(f->R.rdi, f->R.rsi);
 		break;
 	case SYS_MMAP:
-	    f->R.rax = mmap(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
+	    f->R.rax = mmap(f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8, f->R.r9);
 		break;
 	case SYS_MUNMAP:
 		munmap(f->R.rdi);
 		break;
+	case SYS_MADVISE:
+		f->R.rax = madvise((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_MLOCK:
+		f->R.rax = mlock((void *) f->R.rdi, f->R.rsi);
+		break;
+	case SYS_MUNLOCK:
+		f->R.rax = munlock((void *) f->R.rdi, f->R.rsi);
+		break;
+	case SYS_MSYNC:
+		f->R.rax = msync((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_FAULTSTAT:
+		f->R.rax = faultstat_get(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_RSSLIMIT:
+		f->R.rax = rsslimit(f->R.rdi);
+		break;
+	case SYS_RSSSTAT:
+		f->R.rax = rss_stat_get(f->R.rdi);
+		break;
+	case SYS_SHMGET:
+		f->R.rax = do_shmget(f->R.rdi, f->R.rsi);
+		break;
+	case SYS_SHMAT:
+		f->R.rax = (uint64_t) do_shmat(f->R.rdi, (void *) f->R.rsi);
+		break;
+	case SYS_SHMDT:
+		f->R.rax = do_shmdt((void *) f->R.rdi);
+		break;
+	case SYS_FALLOCATE:
+		f->R.rax = fallocate(f->R.rdi, f->R.rsi, f->R.rdx);
+		break;
+	case SYS_FSYNC:
+		f->R.rax = fsync(f->R.rdi);
+		break;
 	default:
 		thread_exit();
 		break;
@@ -431,6 +477,33 @@ void seek (int fd, unsigned position){
 	file_seek(file,position);
 }
 
+/* Allocates disk space for LEN bytes of FD from OFFSET, growing the file
+ * if it is shorter.  Returns 0 on success, -1 on error. */
+int fallocate (int fd, off_t offset, off_t len){
+	struct file* file = find_file(fd);
+	if ((uintptr_t) file <= STDOUT || offset < 0 || len <= 0
+			|| offset > INT32_MAX - len) {
+		return -1;
+	}
+	lock_acquire(&lock);
+	bool success = file_allocate(file, offset, len);
+	lock_release(&lock);
+	return success ? 0 : -1;
+}
+
+/* Writes FD's data and metadata to disk.  Returns 0 on success, -1 if
+ * FD is not an open file. */
+int fsync (int fd){
+	struct file* file = find_file(fd);
+	if ((uintptr_t) file <= STDOUT) {
+		return -1;
+	}
+	lock_acquire(&lock);
+	file_sync(file);
+	lock_release(&lock);
+	return 0;
+}
+
 unsigned tell (int fd){
 	struct file* file = find_file(fd);
 	if (file <= 2) {
@@ -442,12 +515,16 @@ unsigned tell (int fd){
 // addr = start
 // mmap()이 파일에 가상 페이지 매핑을 해줘도 적합한지를 체크해주는 함수
 void *
-mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
+mmap (void *addr, size_t length, int writable, int fd, off_t offset, int flags) {
 
 	// 파일의 시작점(offset)이 page-align되지 않았을 때
 	if(offset % PGSIZE != 0){
 		return NULL;
 	}
+	// 모르는 flag가 있을 때
+	if((flags & ~MAP_POPULATE) != 0){
+		return NULL;
+	}
 	// 가상 유저 page 시작 주소가 page-align되어있지 않을 때
 	/* failure case 2: 해당 주소의 시작점이 page-align되어 있는지 & user 영역인지 & 주소값이 null인지 & length가 0이하인지*/
 	if(pg_round_down(addr)!= addr || is_kernel_vaddr(addr) || addr == NULL || (long long)length <= 0){
@@ -469,7 +546,7 @@ mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 		return NULL;
 	}
 
-	return do_mmap(addr, length, writable, target, offset);
+	return do_mmap(addr, length, writable, target, offset, flags);
 }
 
 //  유저 가상 페이지의 변경 사항을 디스크 파일에 업데이트한 뒤, 매핑 정보를 지운다. 여기서 중요한 점은 페이지를 지우는 게 아니라 present bit을 0으로 만들어준다는 점이다. 따라서 munmap() 함수는 정확히는 지정된 주소 범위 addr에 대한 매핑을 해제하는 함수
@@ -483,6 +560,55 @@ munmap (void *addr) {
 	do_munmap(addr);
 }
 
+// [addr, addr + length)가 NULL이 아닌 유저 영역 안에 있는지 확인한다.
+static bool
+is_user_range (void *addr, size_t length) {
+	return addr != NULL && length > 0
+		&& (uint8_t *) addr + length > (uint8_t *) addr
+		&& is_user_vaddr ((uint8_t *) addr + length - 1);
+}
+
+// 범위의 page들에 대해 pager에게 힌트를 준다. (vm_madvise 참조)
+int
+madvise (void *addr, size_t length, int advice) {
+	if (!is_user_range(addr, length))
+		return -1;
+	return vm_madvise(addr, length, advice);
+}
+
+// 범위의 page들을 메모리에 올리고 쫓겨나지 않게 고정한다.
+int
+mlock (void *addr, size_t length) {
+	if (!is_user_range(addr, length))
+		return -1;
+	return vm_mlock(addr, length, true);
+}
+
+int
+munlock (void *addr, size_t length) {
+	if (!is_user_range(addr, length))
+		return -1;
+	return vm_mlock(addr, length, false);
+}
+
+// mmap된 범위의 변경 내용을 파일에 써준다. (do_msync 참조)
+int
+msync (void *addr, size_t length, int flags) {
+	if (!is_user_range(addr, length))
+		return -1;
+	return do_msync(addr, length, flags);
+}
+
+/* Limits the process to PAGES resident frames, 0 for no limit, and
+ * returns the old limit.  A negative PAGES only returns it. */
+int
+rsslimit (int pages) {
+	struct thread *curr = thread_current();
+	if (pages < 0)
+		return curr->rss_limit;
+	return rss_set_limit(curr, pages);
+}
+
 //project 3 add
 void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write){
 	if (buffer <= USER_STACK && buffer >= rsp)
@@ -502,41 +628,28 @@ bool chdir(const char *path_name){
 		return false;
 	}
 
-	char *cp_name = (char *)malloc(strlen(path_name) + 1);
-	strlcpy(cp_name, path_name, strlen(path_name) + 1);
-
-	struct dir *chdir = NULL;
-
-	if(cp_name[0] == '/'){
-		chdir = dir_open_root();
-	} else {
-		chdir = dir_reopen(thread_current()->cur_dir);
-	}
-
-	char *token, *savePtr;
-	token = strtok_r(cp_name, "/", &savePtr);
-
+	// 경로의 마지막 이름까지 찾고, 그것이 디렉터리인지 확인한다.
+	char name[NAME_MAX + 1];
+	struct dir *dir = parse_path(path_name, name);
 	struct inode *inode = NULL;
-	while (token != NULL)
-	{
-		if(!dir_lookup(chdir, token, &inode)){
-			dir_close(chdir);
-			return false;
-		}
-		if(!inode_is_dir(inode)){
-			dir_close(chdir);
-			return false;
-		}
-		dir_close(chdir);
 
-		chdir = dir_open(inode);
+	if(dir == NULL){
+		return false;
+	}
+	dir_lookup(dir, name, &inode);
+	dir_close(dir);
 
-		token = strtok_r(NULL, "/", &savePtr);
+	if(inode == NULL || !inode_is_dir(inode)){
+		inode_close(inode);
+		return false;
 	}
 
+	struct dir *chdir = dir_open(inode);
+	if(chdir == NULL){
+		return false;
+	}
 	dir_close(thread_current()->cur_dir);
 	thread_current()->cur_dir = chdir;
-	free(cp_name);
 	return true;
 }
 
@@ -3,6 +3,8 @@
 #include "vm/vm.h"
 #include "devices/disk.h"
 #include "lib/string.h"
+#include "threads/synch.h"
+#include "vm/zswap.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -21,6 +23,10 @@ static const struct page_operations anon_ops = {
 
 const size_t SECTORS_PER_PAGE = PGSIZE / DISK_SECTOR_SIZE; // 8 = 4096 / 512
 
+struct bitmap *swap_table;
+int swap_size;
+static struct lock swap_lock; // swap_table 보호 (zswapd도 스왑 슬롯을 할당한다)
+
 
 /* Initialize the data for anonymous pages */
 // 이 기능에서는 스왑 디스크를 설정해야 합니다. 또한 스왑 디스크에서 사용 가능한 영역과 사용된 영역을 관리하기 위한 데이터 구조가 필요합니다. 스왑 영역도 PGSIZE(4096바이트) 단위로 관리됩니다.
@@ -32,11 +38,14 @@ vm_anon_init (void) {
 
 	// (SECTORS_PER_PAGE = 8byte)  
 	// SECTORS_PER_PAGE = PGSIZE / DISK_SECTOR_SIZE; 8 = 4096 / 512
-	size_t swap_size = disk_size(swap_disk)/SECTORS_PER_PAGE; 
+	swap_size = disk_size(swap_disk)/SECTORS_PER_PAGE; 
 	// 디스크 섹터는 하드 디스크 내 정보를 저장하는 단위로, 자체적으로 주소를 갖는 storage의 단위다. 즉, 한 디스크 당 몇 개의 섹터가 들어가는지를 나눈 값을 swap_size로 지칭한다. 즉, 해당 swap_disk를 swap할 때 필요한 섹터 수가 결국 swap_size.
 
 	// swap size 크기만큼 swap_table을 비트맵으로 생성
     swap_table = bitmap_create(swap_size);
+	lock_init(&swap_lock);
+
+	zswap_init();
 }
 
 /* Initialize the file mapping */
@@ -51,6 +60,7 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 
 	struct anon_page *anon_page = &page->anon;
 	anon_page->swap_sector = -1;
+	anon_page->zswap = NULL;
 	
 	return true;
 }
@@ -61,10 +71,14 @@ static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
 
+	// 압축 풀에 있으면 디스크를 읽지 않고 압축만 푼다.
+	if (zswap_load(page, kva))
+		return true;
+
 	// 디스크에서 메모리로 데이터 내용을 읽어서 스왑 디스크에서 익명 페이지로 스왑합니다. 데이터의 위치는 페이지가 스왑 아웃될 때 페이지 구조에 스왑 디스크가 저장되어 있어야 한다는 것입니다. 스왑 테이블을 업데이트해야 합니다
 	int find_slot = anon_page->swap_sector; // 스왑 아웃을할때 저장해두었던 섹터(슬롯)을 가져옴
 
-	if (bitmap_test(swap_table,find_slot)==false){ // 스왑테이블에 해당 슬롯(섹터)가 있는지 확인
+	if (find_slot < 0 || bitmap_test(swap_table,find_slot)==false){ // 스왑테이블에 해당 슬롯(섹터)가 있는지 확인
 		return false;
 	}
 
@@ -72,22 +86,24 @@ anon_swap_in (struct page *page, void *kva) {
 		disk_read(swap_disk, find_slot*SECTORS_PER_PAGE+i, kva+DISK_SECTOR_SIZE*i);
 	}
 
+	lock_acquire(&swap_lock);
 	bitmap_set(swap_table,find_slot, false); // 해당 슬롯이 스왑인 되어있다는 표시
+	lock_release(&swap_lock);
+	anon_page->swap_sector = -1;
 
 	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
-// anon_swap_out()은 anonymous page를 디스크 내 swap 공간으로 내리는 작업을 수행하는 함수이다.
-// 비트맵을 순회해 false 값을 갖는(=해당 swap slot이 비어있다는 표시) 비트를 찾는다. 이어서 해당 섹터에 페이지 크기만큼 써줘야 하니 필요한 섹터 수 만큼 disk_write()을 통해 입력해준다. write 작업이 끝나면 해당 스왑 공간에 페이지가 채워졌으니 bitmap_set()으로 slot이 찼다고 표시해준다. 그리고 pml4_clear_page()로 물리 프레임에 올라와 있던 페이지를 지운다.
-static bool
-anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
-
-	int empty_slot = bitmap_scan (swap_table, 0, 1, false);
+/* Writes the page at KVA to a free swap slot and returns the slot, or -1
+   if swap is full. */
+int
+swap_slot_write (const void *kva) {
+	lock_acquire(&swap_lock);
+	size_t empty_slot = bitmap_scan_and_flip (swap_table, 0, 1, false);
+	lock_release(&swap_lock);
 
-	if ((empty_slot) == BITMAP_ERROR) {
-        return false;
+	if (empty_slot == BITMAP_ERROR) {
+        return -1;
     }
     /* 
     한 페이지를 디스크에 써주기 위해 SECTORS_PER_PAGE 개의 섹터에 저장해야 한다.
@@ -96,19 +112,64 @@ anon_swap_out (struct page *page) {
 	swap_size = disk_size(swap_disk)/SECTORS_PER_PAGE; 
     */
    	for (int i = 0; i<SECTORS_PER_PAGE; i++){
-		disk_write(swap_disk, empty_slot*SECTORS_PER_PAGE+i, page->va+DISK_SECTOR_SIZE*i);
+		disk_write(swap_disk, empty_slot*SECTORS_PER_PAGE+i, kva+DISK_SECTOR_SIZE*i);
 	}
+	return empty_slot;
+}
+
+/* Reads swap slot SLOT into the page at KVA and frees the slot. */
+void
+swap_slot_read (int slot, void *kva) {
+	ASSERT (slot >= 0 && bitmap_test (swap_table, slot));
+
+	size_t first = (size_t) slot * SECTORS_PER_PAGE;
+	for (size_t i = 0; i < SECTORS_PER_PAGE; i++)
+		disk_read(swap_disk, first + i, kva + DISK_SECTOR_SIZE * i);
+	swap_slot_free(slot);
+}
+
+/* Frees swap slot SLOT without reading it. */
+void
+swap_slot_free (int slot) {
+	lock_acquire(&swap_lock);
+	bitmap_set(swap_table, slot, false);
+	lock_release(&swap_lock);
+}
+
+/* Writes KVA, the contents of PAGE, to a free swap slot and records the
+   slot in PAGE.  Used by swap-out and by zswap writeback. */
+bool
+anon_swap_write (struct page *page, const void *kva) {
+	int slot = swap_slot_write(kva);
+	if (slot < 0)
+		return false;
+
+	/* 페이지의 swap_index 값을 이 페이지가 저장된 swap slot의 번호로 써준다.*/
+	page->anon.swap_sector = slot;
+	return true;
+}
+
+/* Swap out the page by writing contents to the swap disk. */
+// anon_swap_out()은 anonymous page를 디스크 내 swap 공간으로 내리는 작업을 수행하는 함수이다.
+// 비트맵을 순회해 false 값을 갖는(=해당 swap slot이 비어있다는 표시) 비트를 찾는다. 이어서 해당 섹터에 페이지 크기만큼 써줘야 하니 필요한 섹터 수 만큼 disk_write()을 통해 입력해준다. write 작업이 끝나면 해당 스왑 공간에 페이지가 채워졌으니 bitmap_set()으로 slot이 찼다고 표시해준다. 그리고 pml4_clear_page()로 물리 프레임에 올라와 있던 페이지를 지운다.
+static bool
+anon_swap_out (struct page *page) {
+	void *kva = page->frame->kva;
+	uint64_t *pml4 = page->owner->pml4;
 
     /*
-    swap table의 해당 페이지에 대한 swap slot의 비트를 true로 바꿔주고
-    해당 페이지의 PTE에서 present bit을 0으로 바꿔준다.
-    이제 프로세스가 이 페이지에 접근하면 page fault가 뜬다.
+    복사하기 전에 해당 페이지의 PTE에서 present bit을 0으로 바꿔주고 TLB도 비운다.
+    그래야 압축하거나 디스크에 쓰는 동안 프로세스가 쓴 내용이 사라지지 않는다.
+    이제 프로세스가 이 페이지에 접근하면 page fault가 뜨고, 내보내기가 끝날 때까지 기다린다.
     */
-	bitmap_set(swap_table,empty_slot, true);
-	pml4_clear_page(thread_current()->pml4, page->va);
+	pml4_clear_page(pml4, page->va);
 
-	/* 페이지의 swap_index 값을 이 페이지가 저장된 swap slot의 번호로 써준다.*/
-	anon_page->swap_sector = empty_slot;
+	// 먼저 압축 풀에 넣어보고, 압축이 안 되거나 풀이 꽉 찼으면 디스크로 보낸다.
+	if (!zswap_store(page, kva) && !anon_swap_write(page, kva)) {
+		// 둘 다 실패하면 page는 frame에 그대로 남으므로 매핑을 되돌린다.
+		pml4_set_page(pml4, page->va, kva, page->writable);
+		return false;
+	}
 	return true;
 }
 
@@ -116,4 +177,13 @@ anon_swap_out (struct page *page) {
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
-}
\ No newline at end of file
+
+	// 압축 풀 엔트리를 먼저 지워야 zswapd가 이 페이지를 디스크에 쓰는 중이 아님이 보장된다.
+	zswap_invalidate(page);
+	if (anon_page->swap_sector >= 0) {
+		lock_acquire(&swap_lock);
+		bitmap_set(swap_table, anon_page->swap_sector, false);
+		lock_release(&swap_lock);
+		anon_page->swap_sector = -1;
+	}
+}
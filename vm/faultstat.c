@@ -0,0 +1,113 @@
+/* faultstat.c: Page fault classification and latency histograms.
+ *
+ * vm_try_handle_fault() reports every fault here with its class and the
+ * TSC cycles it took to handle.  Counts are kept per process and for the
+ * whole system; latencies go into system-wide log2 histograms, one per
+ * class.  User programs read them with the faultstat() system call, and
+ * the kernel prints them at shutdown.
+ *
+ * It also times how long processes take from exec() to main(), which is
+ * mostly spent loading the binary and faulting in its first pages.  The
+ * end is taken as the first system call after exec(): for the test
+ * programs that is the "begin" message of main(). */
+
+#include "vm/faultstat.h"
+#include <stdio.h>
+#include "intrinsic.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+static uint64_t fault_cnt[FAULT_CLASS_CNT];
+static uint64_t fault_cycles[FAULT_CLASS_CNT];
+static uint64_t fault_hist[FAULT_CLASS_CNT][FAULT_HIST_BUCKETS];
+static uint64_t exec_cnt;
+static uint64_t exec_cycles;
+
+static const char *class_names[FAULT_CLASS_CNT] = {
+	"anon", "file", "text", "swap", "stack", "zero", "cow", "spurious", "bad",
+};
+
+/* Returns the histogram bucket for CYCLES: floor(log2(CYCLES)). */
+static int
+hist_bucket (uint64_t cycles) {
+	int b = 0;
+	while (cycles >>= 1)
+		b++;
+	return b < FAULT_HIST_BUCKETS ? b : FAULT_HIST_BUCKETS - 1;
+}
+
+/* Records a fault of class CLS that took CYCLES to handle, against the
+ * running process and the system. */
+void
+faultstat_record (enum fault_class cls, uint64_t cycles) {
+	ASSERT (cls < FAULT_CLASS_CNT);
+
+	enum intr_level old_level = intr_disable ();
+	fault_cnt[cls]++;
+	fault_cycles[cls] += cycles;
+	fault_hist[cls][hist_bucket (cycles)]++;
+	thread_current ()->fault_cnt[cls]++;
+	intr_set_level (old_level);
+}
+
+/* Starts timing an exec() by the running process. */
+void
+faultstat_exec_start (void) {
+	thread_current ()->exec_tsc = rdtsc ();
+}
+
+/* Called on every system call: the first one after an exec() ends the
+ * time from exec() to main(). */
+void
+faultstat_exec_main (void) {
+	struct thread *t = thread_current ();
+	if (t->exec_tsc == 0)
+		return;
+
+	uint64_t cycles = rdtsc () - t->exec_tsc;
+	t->exec_tsc = 0;
+	enum intr_level old_level = intr_disable ();
+	exec_cnt++;
+	exec_cycles += cycles;
+	intr_set_level (old_level);
+}
+
+/* Returns the number of faults of class CLS in SCOPE (FAULTSTAT_SELF or
+ * FAULTSTAT_ALL) if BUCKET is -1, or else the count in that bucket of
+ * the system-wide histogram for CLS.  Returns -1 for bad arguments. */
+int64_t
+faultstat_get (int scope, int cls, int bucket) {
+	if (cls < 0 || cls >= FAULT_CLASS_CNT || bucket < -1
+			|| bucket >= FAULT_HIST_BUCKETS)
+		return -1;
+
+	if (scope == FAULTSTAT_SELF && bucket == -1)
+		return thread_current ()->fault_cnt[cls];
+	if (scope == FAULTSTAT_ALL)
+		return bucket == -1 ? fault_cnt[cls] : fault_hist[cls][bucket];
+	return -1;
+}
+
+/* Prints fault counts, mean latencies and histograms, and the mean time
+ * from exec() to main(). */
+void
+faultstat_print (void) {
+	printf ("Page faults:");
+	for (int c = 0; c < FAULT_CLASS_CNT; c++)
+		printf (" %llu %s", fault_cnt[c], class_names[c]);
+	printf ("\n");
+
+	for (int c = 0; c < FAULT_CLASS_CNT; c++) {
+		if (fault_cnt[c] == 0)
+			continue;
+		printf ("  %-8s mean %llu cycles:", class_names[c],
+				fault_cycles[c] / fault_cnt[c]);
+		for (int b = 0; b < FAULT_HIST_BUCKETS; b++)
+			if (fault_hist[c][b] != 0)
+				printf (" 2^%d:%llu", b, fault_hist[c][b]);
+		printf ("\n");
+	}
+	if (exec_cnt != 0)
+		printf ("Exec to main: %llu execs, mean %llu cycles\n",
+				exec_cnt, exec_cycles / exec_cnt);
+}
@@ -1,14 +1,21 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include <string.h>
+#include "filesys/inode.h"
+#include "threads/synch.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
 #include "userprog/process.h"
+#include <syscall-nr.h>
 
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
 static void file_backed_destroy (struct page *page);
 void do_munmap (void *addr);
-void* do_mmap (void *addr, size_t length, int writable, struct file *file, off_t offset);
+void* do_mmap (void *addr, size_t length, int writable, struct file *file, off_t offset, int flags);
 
 /* DO NOT MODIFY this struct */
 static const struct page_operations file_ops = {
@@ -18,9 +25,66 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+static bool text_swap_in (struct page *page, void *kva);
+static bool text_swap_out (struct page *page);
+static void text_destroy (struct page *page);
+
+/* Read-only executable text.  The type keeps VM_ANON so that the rest of
+ * the VM treats these pages like the other segment pages. */
+static const struct page_operations text_ops = {
+	.swap_in = text_swap_in,
+	.swap_out = text_swap_out,
+	.destroy = text_destroy,
+	.type = VM_ANON | VM_TEXT,
+};
+
+/* Loaded text frames, keyed by (inode, offset).  Each cached frame holds
+ * a reference to its inode and denies writes to it, so the key stays
+ * unique and the contents stay valid while the frame is cached.  A frame
+ * leaves the cache when it is evicted or when its last page goes away. */
+static struct hash text_cache;
+static struct lock text_lock;     /* Protects text_cache and text rmaps. */
+static long long text_share_cnt;  /* Faults served from text_cache. */
+
+static uint64_t
+text_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry (e, struct frame, text_elem);
+	return hash_bytes (&f->inode, sizeof f->inode) ^ hash_int (f->offset);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, text_elem);
+	const struct frame *b = hash_entry (b_, struct frame, text_elem);
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->offset < b->offset;
+}
+
+/* Most pages written back with one file_write_at(). */
+#define WB_CLUSTER 16
+
+/* How often mmap_flushd looks for a flush request from msync(MS_ASYNC). */
+#define WB_POLL_TICKS (TIMER_FREQ / 10)
+
+int64_t mmap_flush_ticks = TIMER_FREQ;
+
+/* Held from the moment a dirty mmap page is copied out until the copy
+ * reaches the file, and by file_backed_swap_in().  A page that is
+ * evicted clean in between is then never read back stale. */
+static struct lock wb_lock;
+static bool wb_requested;         /* Set by msync(MS_ASYNC). */
+
+static void mmap_flushd (void *aux);
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	hash_init (&text_cache, text_hash, text_less, NULL);
+	lock_init (&text_lock);
+	lock_init (&wb_lock);
+	thread_create ("mmap_flushd", PRI_DEFAULT, mmap_flushd, NULL);
 }
 
 /* Initialize the file backed page */
@@ -30,6 +94,7 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+	return true;
 }
 
 /* Swap in the page by read contents from the file. */
@@ -49,9 +114,11 @@ file_backed_swap_in (struct page *page, void *kva) {
 	size_t page_read_bytes = aux->read_bytes;
 	size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-	file_seek(file,offset);
-
-	if(file_read(file, kva, page_read_bytes)!=(int)page_read_bytes){
+	// 이 page의 내용이 아직 write-back 중일 수 있으므로 끝날 때까지 기다린다.
+	lock_acquire(&wb_lock);
+	off_t read = file_read_at(file, kva, page_read_bytes, offset);
+	lock_release(&wb_lock);
+	if(read != (int)page_read_bytes){
 		return false;
 	}
 
@@ -70,12 +137,13 @@ file_backed_swap_out (struct page *page) {
 	struct container* aux = (struct container*)page->uninit.aux;
 	struct file * file = aux->file;
 
-	if(pml4_is_dirty(thread_current()->pml4,page->va)){
-		file_write_at(file,page->va, aux->read_bytes, aux->offset);
-		// page->va == frame->page->kva (page->va 있는 정보나 frame에 있는 정보나 같다.)
-		pml4_set_dirty(thread_current()->pml4, page->va, false);
+	// 다른 프로세스의 page일 수도 있으므로 page 소유자의 page table과 frame의 kva를 사용한다.
+	uint64_t *pml4 = page->owner->pml4;
+	if(pml4_is_dirty(pml4,page->va)){
+		file_write_at(file,page->frame->kva, aux->read_bytes, aux->offset);
+		pml4_set_dirty(pml4, page->va, false);
 	}
-	pml4_clear_page(thread_current()->pml4, page->va);
+	pml4_clear_page(pml4, page->va);
 	return true;
 }
 
@@ -85,6 +153,143 @@ file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
 }
 
+/* Initializes a read-only text page.  Called with the page still in its
+ * uninit state, so the container is read before it is overwritten. */
+bool
+text_initializer (struct page *page, enum vm_type type UNUSED, void *kva UNUSED) {
+	struct container *c = page->uninit.aux;
+	struct text_page text = {
+		.file = c->file,
+		.offset = c->offset,
+		.read_bytes = c->read_bytes,
+	};
+
+	page->operations = &text_ops;
+	page->text = text;
+	return true;
+}
+
+/* Returns the cached frame for FILE at OFFSET, or NULL.
+ * Caller holds text_lock. */
+static struct frame *
+text_lookup (struct file *file, off_t offset) {
+	struct frame key;
+	key.inode = file_get_inode (file);
+	key.offset = offset;
+
+	struct hash_elem *e = hash_find (&text_cache, &key.text_elem);
+	return e != NULL ? hash_entry (e, struct frame, text_elem) : NULL;
+}
+
+/* Drops FRAME from text_cache.  Caller holds text_lock. */
+static void
+text_uncache (struct frame *frame) {
+	if (frame->inode == NULL)
+		return;
+	hash_delete (&text_cache, &frame->text_elem);
+	inode_allow_write (frame->inode);
+	inode_close (frame->inode);
+	frame->inode = NULL;
+}
+
+/* If PAGE is a text page whose contents another process has already
+ * loaded, maps that frame at PAGE read-only and returns true. */
+bool
+text_attach (struct page *page) {
+	struct file *file;
+	off_t offset;
+
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		if (!(page->uninit.type & VM_TEXT))
+			return false;
+		struct container *c = page->uninit.aux;
+		file = c->file;
+		offset = c->offset;
+	} else if (page->operations == &text_ops) {
+		file = page->text.file;
+		offset = page->text.offset;
+	} else
+		return false;
+
+	lock_acquire (&text_lock);
+	struct frame *frame = text_lookup (file, offset);
+	if (frame == NULL) {
+		lock_release (&text_lock);
+		return false;
+	}
+
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		page->uninit.page_initializer (page, page->uninit.type, frame->kva);
+	vm_frame_link (frame, page);
+	if (!install_page (page->va, frame->kva, false)) {
+		vm_page_unmap (page);
+		lock_release (&text_lock);
+		return false;
+	}
+	text_share_cnt++;
+	lock_release (&text_lock);
+	return true;
+}
+
+/* Offers PAGE's frame, just loaded from the file, to other processes. */
+void
+text_publish (struct page *page) {
+	struct frame *frame = page->frame;
+
+	lock_acquire (&text_lock);
+	if (frame->refcnt == 1 && frame->inode == NULL
+			&& text_lookup (page->text.file, page->text.offset) == NULL) {
+		frame->inode = inode_reopen (file_get_inode (page->text.file));
+		frame->offset = page->text.offset;
+		inode_deny_write (frame->inode);
+		hash_insert (&text_cache, &frame->text_elem);
+	}
+	lock_release (&text_lock);
+}
+
+/* Reloads an evicted text page from the executable. */
+static bool
+text_swap_in (struct page *page, void *kva) {
+	struct text_page *text = &page->text;
+
+	if (file_read_at (text->file, kva, text->read_bytes, text->offset)
+			!= (int) text->read_bytes)
+		return false;
+	memset (kva + text->read_bytes, 0, PGSIZE - text->read_bytes);
+	return true;
+}
+
+/* Evicts a text frame.  Text is never dirty, so this only unmaps it from
+ * every process that shares it.  The rmap is emptied here, under
+ * text_lock, since exiting mappers may be detaching concurrently. */
+static bool
+text_swap_out (struct page *page) {
+	struct frame *frame = page->frame;
+
+	lock_acquire (&text_lock);
+	text_uncache (frame);
+	while (!list_empty (&frame->rmap)) {
+		struct page *p = list_entry (list_front (&frame->rmap), struct page,
+				rmap_elem);
+		vm_page_unmap (p);
+	}
+	lock_release (&text_lock);
+	return true;
+}
+
+/* Drops PAGE's reference to its frame, freeing the frame if it was the
+ * last one. */
+static void
+text_destroy (struct page *page) {
+	lock_acquire (&text_lock);
+	struct frame *frame = page->frame;
+	if (frame != NULL && vm_page_unmap (page) == 0) {
+		text_uncache (frame);
+		vm_frame_free (frame);
+	}
+	lock_release (&text_lock);
+}
+
 /* Do the mmap */
 // addr부터 시작하는 연속된 유저 가상 메모리 공간에 page들을 만들어 file의 offset부터 length에 해당하는 file의 정보를 각 page마다 저장한다. 프로세스가 이 page에 접근해서 page fault를 발생시키면 physical frame과 mapping하여 (claim) disk에서 file data를 frame에 복사함
 
@@ -97,7 +302,7 @@ file_backed_destroy (struct page *page) {
 
 // 성공하면 이 함수는 파일이 매핑된 가상 주소를 반환합니다. 실패하면 파일을 매핑하는 데 유효한 주소가 아닌 NULL을 반환해야 합니다.
 
-void* do_mmap (void *addr, size_t length, int writable, struct file *file, off_t offset) {
+void* do_mmap (void *addr, size_t length, int writable, struct file *file, off_t offset, int flags) {
 	//size_t length = 사용자가 요청한 길이		
 	struct file * get_file = file_reopen(file); // 기존에 열린파일이면 close되면 중단될 수 있다.
 	void *start_addr  = addr; // 시작 주소를 return하기 위해 저장
@@ -132,41 +337,220 @@ void* do_mmap (void *addr, size_t length, int writable, struct file *file, off_t
 		addr += PGSIZE;
 		offset += page_read_bytes;
 	}
+
+	// MAP_POPULATE면 fault를 기다리지 않고 지금 읽어 둔다. (남는 frame이 없으면 나머지는 lazy하게 남는다)
+	if (flags & MAP_POPULATE)
+		vm_populate(start_addr, length);
 	return start_addr;
 }
 
+/* A run of dirty mmap pages, contiguous in one file, copied into BUF
+ * to be written back with one file_write_at(). */
+struct wb_run {
+	struct file *file;
+	off_t offset;             /* File offset of the first page. */
+	size_t bytes;
+	size_t pages;
+	size_t cap;               /* Pages that fit in BUF. */
+	uint8_t *buf;
+};
+
+static void
+wb_init (struct wb_run *run) {
+	run->bytes = run->pages = 0;
+	run->cap = WB_CLUSTER;
+	run->buf = palloc_get_multiple (0, WB_CLUSTER);
+	if (run->buf == NULL) {
+		run->cap = 1;
+		run->buf = palloc_get_page (PAL_ASSERT);
+	}
+}
+
+/* Writes out RUN and empties it. */
+static void
+wb_flush (struct wb_run *run) {
+	if (run->bytes > 0)
+		file_write_at (run->file, run->buf, run->bytes, run->offset);
+	run->bytes = run->pages = 0;
+}
+
+static void
+wb_done (struct wb_run *run) {
+	wb_flush (run);
+	palloc_free_multiple (run->buf, run->cap);
+}
+
+/* If FRAME holds a dirty page of a file mapping, clears the page's dirty
+ * bit and appends a copy of it to RUN.  Returns false, leaving the page
+ * alone, if the page does not continue RUN, which must then be written
+ * out first.  Interrupts are off from the dirty check through the copy,
+ * so the frame cannot be evicted and reused underneath, and a write that
+ * lands after the clear dirties the page again.  Caller holds wb_lock. */
+static bool
+wb_add (struct wb_run *run, struct frame *frame) {
+	enum intr_level old_level = intr_disable ();
+	struct page *page = frame->page;
+	if (page == NULL || VM_TYPE (page->operations->type) != VM_FILE
+			|| page->owner->pml4 == NULL
+			|| pml4_get_page (page->owner->pml4, page->va) != frame->kva
+			|| !pml4_is_dirty (page->owner->pml4, page->va)) {
+		intr_set_level (old_level);
+		return true;
+	}
+
+	struct container *c = page->uninit.aux;
+	if (run->pages > 0
+			&& (c->file != run->file
+				|| c->offset != run->offset + (off_t) run->bytes
+				|| run->bytes != run->pages * PGSIZE
+				|| run->pages == run->cap)) {
+		intr_set_level (old_level);
+		return false;
+	}
+	pml4_test_and_clear_dirty (page->owner->pml4, page->va);
+	memcpy (run->buf + run->pages * PGSIZE, frame->kva, c->read_bytes);
+	intr_set_level (old_level);
+
+	if (run->pages++ == 0) {
+		run->file = c->file;
+		run->offset = c->offset;
+	}
+	run->bytes += c->read_bytes;
+	return true;
+}
+
+/* Writes back the dirty pages of the current process's file mappings
+ * between START and END.  Other pages in the range are skipped. */
+void
+mmap_writeback (uint8_t *start, uint8_t *end) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct wb_run run;
+
+	wb_init (&run);
+	lock_acquire (&wb_lock);
+	for (uint8_t *va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		while (page != NULL && page->frame != NULL
+				&& !wb_add (&run, page->frame))
+			wb_flush (&run);
+	}
+	wb_flush (&run);
+	lock_release (&wb_lock);
+	wb_done (&run);
+}
+
+/* Writes back every dirty mmap page in the frame table.  The frame table
+ * is unlocked while a run is written out; CURSOR, which only this walk
+ * knows to skip, keeps its place meanwhile. */
+static void
+mmap_writeback_all (void) {
+	struct wb_run run;
+	struct list_elem cursor;
+
+	wb_init (&run);
+	lock_acquire (&wb_lock);
+	lock_acquire (&frame_table_lock);
+	list_push_front (&frame_table, &cursor);
+	while (list_next (&cursor) != list_end (&frame_table)) {
+		struct list_elem *e = list_next (&cursor);
+		if (!wb_add (&run, list_entry (e, struct frame, frame_elem))) {
+			/* The frame after CURSOR is looked at again afterwards. */
+			lock_release (&frame_table_lock);
+			wb_flush (&run);
+			lock_acquire (&frame_table_lock);
+			continue;
+		}
+		list_remove (&cursor);
+		list_insert (list_next (e), &cursor);
+	}
+	list_remove (&cursor);
+	lock_release (&frame_table_lock);
+	wb_flush (&run);
+	lock_release (&wb_lock);
+	wb_done (&run);
+}
+
+/* Background writeback.  Bounds how long a write to a file mapping stays
+ * in memory only, by flushing every mmap_flush_ticks, or sooner when
+ * msync(MS_ASYNC) asks. */
+static void
+mmap_flushd (void *aux UNUSED) {
+	int64_t waited = 0;
+
+	for (;;) {
+		timer_sleep (WB_POLL_TICKS);
+		waited += WB_POLL_TICKS;
+		if (wb_requested
+				|| (mmap_flush_ticks > 0 && waited >= mmap_flush_ticks)) {
+			wb_requested = false;
+			waited = 0;
+			mmap_writeback_all ();
+		}
+	}
+}
+
+/* Writes back the dirty pages of the file mappings from ADDR to
+ * ADDR + LENGTH.  With MS_SYNC the data is in the file on return; with
+ * MS_ASYNC the background flusher is asked to write it soon.  Returns 0
+ * on success, -1 if ADDR is misaligned, FLAGS is invalid or a page of the
+ * range is not part of a file mapping. */
+int
+do_msync (void *addr, size_t length, int flags) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = addr;
+	uint8_t *end = pg_round_up (start + length);
+
+	if (pg_ofs (addr) != 0
+			|| (flags & ~(MS_ASYNC | MS_INVALIDATE | MS_SYNC)) != 0
+			|| ((flags & MS_ASYNC) && (flags & MS_SYNC)))
+		return -1;
+	for (uint8_t *va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		if (page == NULL || page_get_type (page) != VM_FILE)
+			return -1;
+	}
+
+	if (flags & MS_SYNC)
+		mmap_writeback (start, end);
+	else if (flags & MS_ASYNC)
+		wb_requested = true;
+	return 0;
+}
+
 /* Do the munmap */
 // memory unmapping을 실행한다. 즉, 페이지에 연결되어 있는 물리 프레임과의 연결을 끊어준다. 유저 가상 메모리의 시작 주소 addr부터 연속으로 나열된 페이지 모두를 매핑 해제한다.
 // 이때 페이지의 Dirty bit이 1인 페이지는 매핑 해제 전에 변경 사항을 디스크 파일에 업데이트해줘야 한다. 이를 위해 페이지의 container 구조체에서 연결된 파일에 대한 정보를 가져온다.
 void do_munmap (void *addr) {
-	while(true){
-		struct thread *curr = thread_current();
-		struct page *find_page = spt_find_page(&curr->spt, addr);
-		// struct frame *find_frame =find_page->frame;
-		
-		if (find_page == NULL) {
-    		return NULL;
-    	}
-
-		// 연결 해제
-		// find_page->frame = NULL;
-		// find_frame->page = NULL;
-
-		struct container* container = (struct container*)find_page->uninit.aux;
-		// 페이지의 dirty bit이 1이면 true를, 0이면 false를 리턴한다.
-		if (pml4_is_dirty(curr->pml4, find_page->va)){
-			// 물리 프레임에 변경된 데이터를 다시 디스크 파일에 업데이트 buffer에 있는 데이터를 size만큼, file의 file_ofs부터 써준다.
-			file_write_at(container->file, addr, container->read_bytes, container->offset);
-			// dirty bit = 0
-			// 인자로 받은 dirty의 값이 1이면 page의 dirty bit을 1로, 0이면 0으로 변경해준다.
-			pml4_set_dirty(curr->pml4,find_page->va,0);
-		} 
-		// dirty bit = 0
-		// 인자로 받은 dirty의 값이 1이면 page의 dirty bit을 1로, 0이면 0으로 변경해준다.
-		
-		// present bit = 0
-		// 페이지의 present bit 값을 0으로 만들어주는 함수
-		pml4_clear_page(curr->pml4, find_page->va); 
-		addr += PGSIZE;
+	struct thread *curr = thread_current();
+	struct page *first = spt_find_page(&curr->spt, addr);
+	uint8_t *end = addr;
+
+	if (first == NULL || page_get_type(first) != VM_FILE)
+		return;
+
+	// 같은 파일을 매핑한 연속된 page들의 끝을 찾는다.
+	struct file *file = ((struct container *) first->uninit.aux)->file;
+	for (;;) {
+		struct page *page = spt_find_page(&curr->spt, end);
+		if (page == NULL || page_get_type(page) != VM_FILE
+				|| ((struct container *) page->uninit.aux)->file != file)
+			break;
+		end += PGSIZE;
 	}
-}
\ No newline at end of file
+
+	// 페이지의 dirty bit이 1인 page들을 모아서 파일에 써준다. (이어지는 page들은 한 번에 쓴다)
+	mmap_writeback(addr, end);
+
+	// present bit = 0
+	// TLB는 페이지마다 비우지 않고 끝에서 한 번에 비운다. 빈 page table도 그때 반환한다.
+	struct mmu_gather tlb;
+	mmu_gather_init(&tlb, curr->pml4);
+	for (uint8_t *va = addr; va < end; va += PGSIZE)
+		mmu_gather_clear_page(&tlb, va);
+	mmu_gather_free_tables(&tlb, addr, end);
+	mmu_gather_finish(&tlb);
+
+	// frame과의 연결을 끊고 spt에서도 지워서, 이후 이 범위에 접근하면 fault가 나게 한다.
+	for (uint8_t *va = addr; va < end; va += PGSIZE)
+		spt_remove_page(&curr->spt, spt_find_page(&curr->spt, va));
+}
@@ -0,0 +1,607 @@
+/* replace.c: Page replacement policies.
+ *
+ * The pager asks the policy selected with "-vmpolicy=NAME" which frame
+ * to evict.  Policies learn about use only through the accessed bits of
+ * the page table entries that map a frame, which they sample and clear
+ * as their clock hands pass; frame_referenced() does that for all of
+ * them and reports each hit to on_access_sample().
+ *
+ *   clock     One hand: evict the first frame not used since the hand
+ *             last passed it.
+ *   clock2    Two hands: the front hand clears accessed bits, the back
+ *             hand, a quarter of memory behind, evicts the first frame
+ *             not used since.
+ *   clockpro  CLOCK-Pro: frames are hot or cold.  Only cold frames are
+ *             evicted.  A new page is cold and in its test period; if it
+ *             is used again, or refaults soon after eviction, it becomes
+ *             hot.  The cold share of memory adapts to the refaults.
+ *   arc       ARC in its clock form (CAR), since hits cannot be seen one
+ *             by one: recency clock T1, frequency clock T2 and the ghost
+ *             lists B1 and B2 of pages evicted from each, which steer the
+ *             target size of T1. */
+
+#include "vm/replace.h"
+#include <debug.h>
+#include <list.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "vm/vm.h"
+
+const char *replace_policy_name = "clock";
+static const struct replace_policy *policy;
+
+/* While set, only frames whose page belongs to this process, or with
+ * VICTIM_OVER_LIMIT to any process over its resident limit, are picked. */
+static struct thread *victim_owner;
+#define VICTIM_OVER_LIMIT ((struct thread *) 1)
+
+static bool rss_over_limit (const struct thread *t);
+static size_t over_limit_cnt;           /* Processes over their limit. */
+
+/* Returns whether FRAME may be picked for eviction now. */
+static bool
+frame_candidate (const struct frame *frame) {
+	if (frame->pin_cnt > 0)
+		return false;
+	if (victim_owner == VICTIM_OVER_LIMIT)
+		return rss_over_limit (frame->page->owner);
+	return victim_owner == NULL || frame->page->owner == victim_owner;
+}
+
+/* Tests and clears the accessed bits of all pages mapping FRAME. */
+static bool
+frame_referenced (struct frame *frame) {
+	bool accessed = false;
+
+	for (struct list_elem *e = list_begin (&frame->rmap);
+			e != list_end (&frame->rmap); e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, rmap_elem);
+		uint64_t *pml4 = page->owner->pml4;
+		if (pml4 != NULL && pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	if (accessed && policy->on_access_sample != NULL)
+		policy->on_access_sample (frame);
+	return accessed;
+}
+
+/* Non-resident pages remembered by CLOCK-Pro and ARC, oldest first.  A
+ * page is identified by its struct page, which outlives the frame; a
+ * page freed and reallocated at the same address may inherit a ghost,
+ * which only skews the policy a little. */
+struct ghost {
+	struct list_elem elem;
+	const struct page *page;
+};
+
+struct ghost_list {
+	struct list list;
+	size_t cnt;
+};
+
+static void
+ghost_init (struct ghost_list *g) {
+	list_init (&g->list);
+	g->cnt = 0;
+}
+
+/* Forgets the oldest ghost of G. */
+static void
+ghost_pop (struct ghost_list *g) {
+	if (g->cnt == 0)
+		return;
+	free (list_entry (list_pop_front (&g->list), struct ghost, elem));
+	g->cnt--;
+}
+
+/* Remembers PAGE as the newest ghost of G. */
+static void
+ghost_push (struct ghost_list *g, const struct page *page) {
+	struct ghost *ghost = malloc (sizeof *ghost);
+	if (ghost == NULL)
+		return;
+	ghost->page = page;
+	list_push_back (&g->list, &ghost->elem);
+	g->cnt++;
+}
+
+/* Removes PAGE from G and returns whether it was there. */
+static bool
+ghost_remove (struct ghost_list *g, const struct page *page) {
+	for (struct list_elem *e = list_rbegin (&g->list);
+			e != list_rend (&g->list); e = list_prev (e)) {
+		struct ghost *ghost = list_entry (e, struct ghost, elem);
+		if (ghost->page == page) {
+			list_remove (e);
+			free (ghost);
+			g->cnt--;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* The ring of resident frames walked by the clock hands of clock,
+ * clock2 and clockpro.  New frames go in just behind the eviction hand,
+ * so they are the last it reaches. */
+static struct list ring;
+static size_t ring_cnt;
+static struct list_elem *hand;          /* Eviction (back, cold) hand. */
+static struct list_elem *hand2;         /* Front or hot hand, or NULL. */
+
+static void
+ring_init (void) {
+	list_init (&ring);
+	ring_cnt = 0;
+	hand = hand2 = NULL;
+}
+
+static void
+ring_insert (struct frame *frame) {
+	if (hand == NULL || hand == list_end (&ring))
+		list_push_back (&ring, &frame->repl_elem);
+	else
+		list_insert (hand, &frame->repl_elem);
+	ring_cnt++;
+}
+
+static void
+ring_remove (struct frame *frame) {
+	if (hand == &frame->repl_elem)
+		hand = list_next (hand);
+	if (hand2 == &frame->repl_elem)
+		hand2 = list_next (hand2);
+	list_remove (&frame->repl_elem);
+	ring_cnt--;
+}
+
+/* Returns the frame under *H and moves *H on, wrapping around. */
+static struct frame *
+ring_advance (struct list_elem **h) {
+	if (ring_cnt == 0)
+		return NULL;
+	if (*h == NULL || *h == list_end (&ring))
+		*h = list_begin (&ring);
+	struct frame *frame = list_entry (*h, struct frame, repl_elem);
+	*h = list_next (*h);
+	return frame;
+}
+
+static void
+clock_on_map (struct frame *frame) {
+	ring_insert (frame);
+}
+
+static void
+clock_on_unmap (struct frame *frame, bool evicted UNUSED) {
+	ring_remove (frame);
+}
+
+static struct frame *
+clock_pick_victim (void) {
+	/* The first round may only clear accessed bits. */
+	for (size_t i = 0; i < 2 * ring_cnt + 1; i++) {
+		struct frame *frame = ring_advance (&hand);
+		if (frame == NULL)
+			return NULL;
+		if (frame_candidate (frame) && !frame_referenced (frame))
+			return frame;
+	}
+	return NULL;
+}
+
+static struct frame *
+clock2_pick_victim (void) {
+	/* Keep the front hand a quarter of memory ahead; insertions and
+	 * removals between the hands let the spread drift a little. */
+	if (hand2 == NULL) {
+		hand2 = hand;
+		for (size_t i = 0; i < ring_cnt / 4 + 1; i++)
+			ring_advance (&hand2);
+	}
+
+	for (size_t i = 0; i < 2 * ring_cnt + 1; i++) {
+		struct frame *front = ring_advance (&hand2);
+		if (front != NULL)
+			frame_referenced (front);
+
+		struct frame *frame = ring_advance (&hand);
+		if (frame == NULL)
+			return NULL;
+		if (frame_candidate (frame) && !frame_referenced (frame))
+			return frame;
+	}
+	return NULL;
+}
+
+static void
+clock2_on_unmap (struct frame *frame, bool evicted UNUSED) {
+	ring_remove (frame);
+	if (ring_cnt == 0)
+		hand2 = NULL;
+}
+
+/* CLOCK-Pro.  HAND is the cold hand, HAND2 the hot hand.  The test
+ * period of a cold page ends when the hot hand passes it; a page that
+ * is evicted during its test period stays in TEST_GHOSTS until then,
+ * approximated here by the ghost list holding at most RING_CNT pages. */
+#define CP_HOT 0x1
+#define CP_TEST 0x2
+
+static struct ghost_list test_ghosts;
+static size_t hot_cnt;
+static size_t cold_target;              /* Cold frames wanted, >= 1. */
+
+static void
+clockpro_init (void) {
+	ring_init ();
+	ghost_init (&test_ghosts);
+	hot_cnt = 0;
+	cold_target = 1;
+}
+
+static void
+clockpro_on_map (struct frame *frame) {
+	if (ghost_remove (&test_ghosts, frame->page)) {
+		/* Reused within its test period: more cold space would have
+		 * kept it. */
+		if (cold_target + 1 < ring_cnt)
+			cold_target++;
+		frame->repl_state = CP_HOT;
+		hot_cnt++;
+	} else
+		frame->repl_state = CP_TEST;
+	ring_insert (frame);
+}
+
+static void
+clockpro_on_access_sample (struct frame *frame) {
+	if (frame->repl_state & CP_HOT)
+		return;
+	if (frame->repl_state & CP_TEST) {
+		frame->repl_state = CP_HOT;
+		hot_cnt++;
+	} else
+		frame->repl_state = CP_TEST;
+}
+
+/* Ends the test period of COLD, whose page was not reused in it. */
+static void
+clockpro_end_test (struct frame *cold) {
+	cold->repl_state &= ~CP_TEST;
+	if (cold_target > 1)
+		cold_target--;
+}
+
+/* Runs the hot hand, turning unused hot frames cold, until the hot
+ * frames fit in what COLD_TARGET leaves them. */
+static void
+clockpro_run_hot_hand (void) {
+	for (size_t i = 0; i < 2 * ring_cnt
+			&& hot_cnt + cold_target > ring_cnt; i++) {
+		struct frame *frame = ring_advance (&hand2);
+		if (frame->repl_state & CP_HOT) {
+			if (!frame_referenced (frame)) {
+				frame->repl_state = 0;
+				hot_cnt--;
+			}
+		} else if (frame->repl_state & CP_TEST)
+			clockpro_end_test (frame);
+	}
+}
+
+static struct frame *
+clockpro_pick_victim (void) {
+	clockpro_run_hot_hand ();
+	for (int pass = 0; pass < 2; pass++) {
+		for (size_t i = 0; i < 2 * ring_cnt + 1; i++) {
+			struct frame *frame = ring_advance (&hand);
+			if (frame == NULL)
+				return NULL;
+			if (!(frame->repl_state & CP_HOT) && frame_candidate (frame)
+					&& !frame_referenced (frame))
+				return frame;
+		}
+		if (victim_owner != NULL)
+			return NULL;
+
+		/* Every cold frame is pinned or in use: cool everything down. */
+		cold_target = ring_cnt;
+		clockpro_run_hot_hand ();
+		cold_target = ring_cnt > 1 ? ring_cnt - 1 : 1;
+	}
+	return NULL;
+}
+
+static void
+clockpro_on_unmap (struct frame *frame, bool evicted) {
+	if (frame->repl_state & CP_HOT)
+		hot_cnt--;
+	else if (evicted && (frame->repl_state & CP_TEST)) {
+		ghost_push (&test_ghosts, frame->page);
+		if (test_ghosts.cnt > ring_cnt) {
+			ghost_pop (&test_ghosts);
+			if (cold_target > 1)
+				cold_target--;
+		}
+	}
+	ring_remove (frame);
+}
+
+/* CAR.  T1 holds frames seen once since they were mapped, T2 frames
+ * whose accessed bit was found set since; each list runs from the clock
+ * hand to the frame just behind it.  P is the target size of T1 and C
+ * the number of resident frames, both counted in frames. */
+#define ARC_T1 0
+#define ARC_T2 1
+
+static struct list t1, t2;
+static size_t t1_cnt, t2_cnt;
+static struct ghost_list b1, b2;
+static size_t arc_p, arc_c;
+
+static void
+arc_init (void) {
+	list_init (&t1);
+	list_init (&t2);
+	t1_cnt = t2_cnt = 0;
+	ghost_init (&b1);
+	ghost_init (&b2);
+	arc_p = 0;
+	arc_c = 0;
+}
+
+static void
+arc_on_map (struct frame *frame) {
+	if (t1_cnt + t2_cnt + 1 > arc_c)
+		arc_c = t1_cnt + t2_cnt + 1;
+
+	if (b1.cnt != 0 && ghost_remove (&b1, frame->page)) {
+		/* Evicted from T1 too early: grow T1. */
+		size_t delta = b1.cnt + 1 >= b2.cnt ? 1 : b2.cnt / (b1.cnt + 1);
+		arc_p = arc_p + delta < arc_c ? arc_p + delta : arc_c;
+		frame->repl_state = ARC_T2;
+	} else if (b2.cnt != 0 && ghost_remove (&b2, frame->page)) {
+		/* Evicted from T2 too early: shrink T1. */
+		size_t delta = b2.cnt + 1 >= b1.cnt ? 1 : b1.cnt / (b2.cnt + 1);
+		arc_p = arc_p > delta ? arc_p - delta : 0;
+		frame->repl_state = ARC_T2;
+	} else {
+		/* A miss in the whole directory: keep it at 2C pages. */
+		if (t1_cnt + b1.cnt >= arc_c)
+			ghost_pop (&b1);
+		else if (t1_cnt + t2_cnt + b1.cnt + b2.cnt >= 2 * arc_c)
+			ghost_pop (&b2);
+		frame->repl_state = ARC_T1;
+	}
+
+	if (frame->repl_state == ARC_T1) {
+		list_push_back (&t1, &frame->repl_elem);
+		t1_cnt++;
+	} else {
+		list_push_back (&t2, &frame->repl_elem);
+		t2_cnt++;
+	}
+}
+
+/* A frame used since the hand last saw it goes to the tail of T2. */
+static void
+arc_on_access_sample (struct frame *frame) {
+	list_remove (&frame->repl_elem);
+	if (frame->repl_state == ARC_T1) {
+		t1_cnt--;
+		t2_cnt++;
+		frame->repl_state = ARC_T2;
+	}
+	list_push_back (&t2, &frame->repl_elem);
+}
+
+/* Runs the clock hand over the CNT frames at the head of L.  Frames
+ * found in use move to the tail of T2; pinned frames stay put. */
+static struct frame *
+arc_scan (struct list *l, size_t cnt) {
+	struct list_elem *e = list_begin (l);
+	for (; cnt > 0 && e != list_end (l); cnt--) {
+		struct frame *frame = list_entry (e, struct frame, repl_elem);
+		e = list_next (e);
+		if (frame_candidate (frame) && !frame_referenced (frame))
+			return frame;
+	}
+	return NULL;
+}
+
+static struct frame *
+arc_pick_victim (void) {
+	/* Two rounds: the first may only move used frames to T2. */
+	for (int round = 0; round < 2; round++) {
+		bool t1_first = t1_cnt != 0 && (t1_cnt >= arc_p || t2_cnt == 0);
+		struct frame *frame;
+		if (t1_first)
+			frame = arc_scan (&t1, t1_cnt);
+		else
+			frame = arc_scan (&t2, t2_cnt);
+		if (frame == NULL)
+			frame = t1_first ? arc_scan (&t2, t2_cnt) : arc_scan (&t1, t1_cnt);
+		if (frame != NULL)
+			return frame;
+	}
+	return NULL;
+}
+
+static void
+arc_on_unmap (struct frame *frame, bool evicted) {
+	list_remove (&frame->repl_elem);
+	if (frame->repl_state == ARC_T1) {
+		t1_cnt--;
+		if (evicted)
+			ghost_push (&b1, frame->page);
+	} else {
+		t2_cnt--;
+		if (evicted)
+			ghost_push (&b2, frame->page);
+	}
+	while (b1.cnt > arc_c)
+		ghost_pop (&b1);
+	while (b2.cnt > arc_c)
+		ghost_pop (&b2);
+}
+
+static const struct replace_policy policies[] = {
+	{ "clock", ring_init, clock_on_map, NULL, clock_pick_victim,
+		clock_on_unmap },
+	{ "clock2", ring_init, clock_on_map, NULL, clock2_pick_victim,
+		clock2_on_unmap },
+	{ "clockpro", clockpro_init, clockpro_on_map,
+		clockpro_on_access_sample, clockpro_pick_victim,
+		clockpro_on_unmap },
+	{ "arc", arc_init, arc_on_map, arc_on_access_sample, arc_pick_victim,
+		arc_on_unmap },
+};
+
+/* Selects the policy named by replace_policy_name. */
+void
+replace_init (void) {
+	for (size_t i = 0; i < sizeof policies / sizeof *policies; i++)
+		if (!strcmp (policies[i].name, replace_policy_name))
+			policy = &policies[i];
+	if (policy == NULL)
+		PANIC ("unknown page replacement policy `%s'", replace_policy_name);
+
+	policy->init ();
+}
+
+/* Hands FRAME, which just got its first page, to the policy. */
+void
+replace_on_map (struct frame *frame) {
+	ASSERT (frame->page != NULL);
+
+	lock_acquire (&frame_table_lock);
+	ASSERT (!frame->repl_tracked);
+	frame->repl_tracked = true;
+	policy->on_map (frame);
+	lock_release (&frame_table_lock);
+}
+
+/* Takes FRAME, whose last page is going away, from the policy. */
+void
+replace_on_unmap (struct frame *frame) {
+	lock_acquire (&frame_table_lock);
+	if (frame->repl_tracked) {
+		frame->repl_tracked = false;
+		policy->on_unmap (frame, false);
+	}
+	lock_release (&frame_table_lock);
+}
+
+/* Picks a victim among the frames allowed by OWNER, as for
+ * victim_owner. */
+static struct frame *
+pick_victim_of (struct thread *owner) {
+	victim_owner = owner;
+	struct frame *victim = policy->pick_victim ();
+	victim_owner = NULL;
+	return victim;
+}
+
+/* Returns a frame to evict, marked evicting, and takes it from the
+ * policy, so that no one else picks it while its page is written out.  With OWNER, only
+ * frames of that process are considered; otherwise frames of processes
+ * over their resident limit go first. */
+struct frame *
+replace_pick_victim (struct thread *owner) {
+	struct frame *victim = NULL;
+
+	lock_acquire (&frame_table_lock);
+	if (owner != NULL)
+		victim = pick_victim_of (owner);
+	else {
+		if (over_limit_cnt > 0)
+			victim = pick_victim_of (VICTIM_OVER_LIMIT);
+		if (victim == NULL)
+			victim = pick_victim_of (NULL);
+	}
+	if (victim != NULL) {
+		ASSERT (victim->repl_tracked);
+		victim->repl_tracked = false;
+		victim->evicting = true;
+		policy->on_unmap (victim, true);
+	}
+	lock_release (&frame_table_lock);
+	return victim;
+}
+
+/* Resident set accounting.  A process is charged for every frame one
+ * of its pages maps, shared or not; the zero page is free.  A process
+ * at its limit replaces its own frames to fault pages in, and frames of
+ * processes over their limit, for example after the limit was lowered,
+ * are evicted before anyone else's. */
+size_t rss_default_limit;
+
+static bool
+rss_over_limit (const struct thread *t) {
+	return t->rss_limit != 0 && t->rss > t->rss_limit;
+}
+
+/* Adds PAGES, which may be negative, to the resident set of T. */
+void
+rss_charge (struct thread *t, int pages) {
+	enum intr_level old_level = intr_disable ();
+	bool was_over = rss_over_limit (t);
+	t->rss += pages;
+	over_limit_cnt += rss_over_limit (t) - was_over;
+	intr_set_level (old_level);
+}
+
+/* Returns whether T must replace one of its own frames to map another. */
+bool
+rss_at_limit (const struct thread *t) {
+	return t->rss_limit != 0 && t->rss >= t->rss_limit;
+}
+
+/* Sets the resident limit of T to PAGES, 0 for none, and returns the
+ * old one. */
+size_t
+rss_set_limit (struct thread *t, size_t pages) {
+	enum intr_level old_level = intr_disable ();
+	bool was_over = rss_over_limit (t);
+	size_t old = t->rss_limit;
+	t->rss_limit = pages;
+	over_limit_cnt += rss_over_limit (t) - was_over;
+	intr_set_level (old_level);
+	return old;
+}
+
+/* Records that PAGE lost its frame to eviction. */
+void
+rss_evicted (struct page *page) {
+	enum intr_level old_level = intr_disable ();
+	page->owner->evict_suffered++;
+	intr_set_level (old_level);
+	rss_charge (page->owner, -1);
+}
+
+/* Returns FIELD, one of enum rss_stat, for the running process, or -1
+ * if FIELD is invalid. */
+int64_t
+rss_stat_get (int field) {
+	struct thread *curr = thread_current ();
+	switch (field) {
+		case RSS_PAGES:
+			return curr->rss;
+		case RSS_LIMIT:
+			return curr->rss_limit;
+		case RSS_EVICT_CAUSED:
+			return curr->evict_caused;
+		case RSS_EVICT_SUFFERED:
+			return curr->evict_suffered;
+		default:
+			return -1;
+	}
+}
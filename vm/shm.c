@@ -0,0 +1,337 @@
+/* shm.c: Anonymous shared memory segments.
+ *
+ * A segment is a run of zero-filled anonymous pages that several
+ * processes can map at once.  Each page of the segment has at most one
+ * frame, owned by the segment: every process that touches the page maps
+ * that frame, and the frame's rmap lists them all.  When the frame is
+ * evicted its contents go to a swap slot kept in the segment, and every
+ * mapper is unmapped at once, as for shared text.  A frame whose last
+ * mapper goes away while the segment is still attached somewhere stays
+ * with the segment, unmapped, until someone touches the page again.
+ *
+ * A segment lives from do_shmget() until the last page that refers to it
+ * is detached or its process exits. */
+
+#include "vm/shm.h"
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "vm/vm.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Largest segment, in pages. */
+#define SHM_MAX_PAGES 1024
+
+/* Where one page of a segment is: in FRAME, in swap slot SWAP_SLOT, or
+ * nowhere yet (zeros). */
+struct shm_slot {
+	struct frame *frame;
+	int swap_slot;
+};
+
+struct shm_segment {
+	struct list_elem elem;     /* Element in shm_list. */
+	int id;
+	int key;                   /* SHM_PRIVATE if it has none. */
+	size_t page_cnt;
+	size_t ref_cnt;            /* Pages, in any process, that refer to it. */
+	struct shm_slot slots[];   /* PAGE_CNT entries. */
+};
+
+static bool shm_swap_in (struct page *page, void *kva);
+static bool shm_swap_out (struct page *page);
+static void shm_destroy (struct page *page);
+
+/* The type keeps VM_ANON so that the rest of the VM treats these pages
+ * like the other anonymous pages. */
+static const struct page_operations shm_ops = {
+	.swap_in = shm_swap_in,
+	.swap_out = shm_swap_out,
+	.destroy = shm_destroy,
+	.type = VM_ANON | VM_SHM,
+};
+
+static struct list shm_list;
+static struct lock shm_lock;       /* Protects segments and shm rmaps. */
+static int next_shm_id = 1;
+
+void
+vm_shm_init (void) {
+	list_init (&shm_list);
+	lock_init (&shm_lock);
+}
+
+/* Returns the segment with ID, or NULL.  Caller holds shm_lock. */
+static struct shm_segment *
+shm_lookup (int id) {
+	for (struct list_elem *e = list_begin (&shm_list); e != list_end (&shm_list);
+			e = list_next (e)) {
+		struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+		if (seg->id == id)
+			return seg;
+	}
+	return NULL;
+}
+
+/* Drops a reference to SEG and frees it with its frames and swap slots
+ * if it was the last one.  Caller holds shm_lock. */
+static void
+shm_put (struct shm_segment *seg) {
+	ASSERT (seg->ref_cnt > 0);
+	if (--seg->ref_cnt > 0)
+		return;
+
+	for (size_t i = 0; i < seg->page_cnt; i++) {
+		struct shm_slot *slot = &seg->slots[i];
+		if (slot->frame != NULL)
+			vm_frame_free (slot->frame);
+		if (slot->swap_slot >= 0)
+			swap_slot_free (slot->swap_slot);
+	}
+	list_remove (&seg->elem);
+	free (seg);
+}
+
+/* Returns the id of the segment with KEY, creating a segment of SIZE
+ * bytes if there is none.  SHM_PRIVATE always creates a new segment.
+ * Returns -1 if SIZE is 0 or too large, or larger than the existing
+ * segment's. */
+int
+do_shmget (int key, size_t size) {
+	size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	if (page_cnt == 0 || page_cnt > SHM_MAX_PAGES)
+		return -1;
+
+	lock_acquire (&shm_lock);
+	if (key != SHM_PRIVATE) {
+		for (struct list_elem *e = list_begin (&shm_list);
+				e != list_end (&shm_list); e = list_next (e)) {
+			struct shm_segment *seg = list_entry (e, struct shm_segment, elem);
+			if (seg->key == key) {
+				int id = page_cnt <= seg->page_cnt ? seg->id : -1;
+				lock_release (&shm_lock);
+				return id;
+			}
+		}
+	}
+
+	struct shm_segment *seg = malloc (sizeof *seg
+			+ page_cnt * sizeof *seg->slots);
+	if (seg == NULL) {
+		lock_release (&shm_lock);
+		return -1;
+	}
+	seg->id = next_shm_id++;
+	seg->key = key;
+	seg->page_cnt = page_cnt;
+	seg->ref_cnt = 0;
+	for (size_t i = 0; i < page_cnt; i++) {
+		seg->slots[i].frame = NULL;
+		seg->slots[i].swap_slot = -1;
+	}
+	list_push_back (&shm_list, &seg->elem);
+	lock_release (&shm_lock);
+	return seg->id;
+}
+
+/* Adds a page for page IDX of SEG at VA to the current process. */
+static bool
+shm_page_new (struct shm_segment *seg, size_t idx, void *va) {
+	struct page *page = malloc (sizeof *page);
+	if (page == NULL)
+		return false;
+
+	page->operations = &shm_ops;
+	page->va = va;
+	page->frame = NULL;
+	page->owner = thread_current ();
+	page->locked = false;
+	page->pinned = false;
+	page->advice = MADV_NORMAL;
+	page->writable = true;
+	page->shm.seg = seg;
+	page->shm.idx = idx;
+
+	lock_acquire (&shm_lock);
+	seg->ref_cnt++;
+	lock_release (&shm_lock);
+
+	if (!spt_insert_page (&thread_current ()->spt, page)) {
+		vm_dealloc_page (page);
+		return false;
+	}
+	return true;
+}
+
+/* Removes the CNT shared pages from ADDR from the current process. */
+static void
+shm_remove (void *addr, size_t cnt) {
+	struct thread *curr = thread_current ();
+	uint8_t *end = (uint8_t *) addr + cnt * PGSIZE;
+
+	/* Unmap everything first so that the TLB is flushed only once. */
+	struct mmu_gather tlb;
+	mmu_gather_init (&tlb, curr->pml4);
+	for (uint8_t *va = addr; va < end; va += PGSIZE)
+		mmu_gather_clear_page (&tlb, va);
+	mmu_gather_free_tables (&tlb, addr, end);
+	mmu_gather_finish (&tlb);
+
+	for (uint8_t *va = addr; va < end; va += PGSIZE)
+		spt_remove_page (&curr->spt, spt_find_page (&curr->spt, va));
+}
+
+/* Maps segment ID at ADDR, which must be page-aligned, in the current
+ * process.  Returns ADDR, or NULL on error.  Pages are mapped lazily. */
+void *
+do_shmat (int id, void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+
+	if (addr == NULL || pg_ofs (addr) != 0)
+		return NULL;
+
+	/* Hold a reference so that the segment cannot go away meanwhile. */
+	lock_acquire (&shm_lock);
+	struct shm_segment *seg = shm_lookup (id);
+	if (seg != NULL)
+		seg->ref_cnt++;
+	lock_release (&shm_lock);
+	if (seg == NULL)
+		return NULL;
+
+	uint8_t *end = (uint8_t *) addr + seg->page_cnt * PGSIZE;
+	bool ok = end > (uint8_t *) addr && is_user_vaddr (end - 1);
+	for (uint8_t *va = addr; ok && va < end; va += PGSIZE)
+		ok = spt_find_page (spt, va) == NULL;
+
+	size_t i = 0;
+	for (; ok && i < seg->page_cnt; i++)
+		ok = shm_page_new (seg, i, (uint8_t *) addr + i * PGSIZE);
+	if (!ok && i > 0)
+		shm_remove (addr, i - 1);
+
+	/* A failed attach leaves a segment that nobody attached yet alone. */
+	lock_acquire (&shm_lock);
+	if (ok || seg->ref_cnt > 1)
+		shm_put (seg);
+	else
+		seg->ref_cnt--;
+	lock_release (&shm_lock);
+	return ok ? addr : NULL;
+}
+
+/* Detaches the segment mapped at ADDR by do_shmat().  Returns 0 on
+ * success, -1 if ADDR is not the start of an attached segment or one of
+ * its pages is locked. */
+int
+do_shmdt (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page = spt_find_page (spt, addr);
+
+	if (page == NULL || pg_ofs (addr) != 0 || page->operations != &shm_ops
+			|| page->shm.idx != 0)
+		return -1;
+
+	struct shm_segment *seg = page->shm.seg;
+	for (size_t i = 0; i < seg->page_cnt; i++) {
+		struct page *p = spt_find_page (spt, (uint8_t *) addr + i * PGSIZE);
+		if (p == NULL || p->operations != &shm_ops || p->shm.seg != seg
+				|| p->shm.idx != i || p->locked)
+			return -1;
+	}
+	shm_remove (addr, seg->page_cnt);
+	return 0;
+}
+
+/* Gives the current process, the child of a fork, its own reference to
+ * the shared page PARENT.  The child maps the frame when it touches it. */
+bool
+shm_fork (struct page *parent) {
+	return shm_page_new (parent->shm.seg, parent->shm.idx, parent->va);
+}
+
+/* Maps PAGE, a page of a shared segment, to the segment's frame for it,
+ * loading that first if needed. */
+bool
+shm_claim (struct page *page) {
+	struct shm_slot *slot = &page->shm.seg->slots[page->shm.idx];
+	struct frame *frame = NULL;
+
+	lock_acquire (&shm_lock);
+	while (slot->frame == NULL && frame == NULL) {
+		/* Getting a frame may evict one of this segment's. */
+		lock_release (&shm_lock);
+		frame = vm_get_frame ();
+		lock_acquire (&shm_lock);
+	}
+	if (slot->frame == NULL) {
+		shm_swap_in (page, frame->kva);
+		slot->frame = frame;
+	} else if (frame != NULL) {
+		/* Someone else loaded it meanwhile. */
+		vm_frame_free (frame);
+	}
+
+	frame = slot->frame;
+	vm_frame_link (frame, page);
+	bool ok = pml4_set_page (page->owner->pml4, page->va, frame->kva, true);
+	if (!ok)
+		vm_page_unmap (page);
+	lock_release (&shm_lock);
+	return ok;
+}
+
+/* Loads the contents of PAGE's slot into KVA: from swap if it was
+ * evicted, zeros if it was never loaded.  Caller holds shm_lock. */
+static bool
+shm_swap_in (struct page *page, void *kva) {
+	struct shm_slot *slot = &page->shm.seg->slots[page->shm.idx];
+
+	if (slot->swap_slot >= 0) {
+		swap_slot_read (slot->swap_slot, kva);
+		slot->swap_slot = -1;
+	} else
+		memset (kva, 0, PGSIZE);
+	return true;
+}
+
+/* Evicts a shared frame to swap and unmaps it from every process that
+ * maps it.  The rmap is emptied here, under shm_lock, since other
+ * mappers may be attaching or detaching concurrently. */
+static bool
+shm_swap_out (struct page *page) {
+	struct shm_slot *slot = &page->shm.seg->slots[page->shm.idx];
+	struct frame *frame = page->frame;
+
+	lock_acquire (&shm_lock);
+	int swap_slot = swap_slot_write (frame->kva);
+	if (swap_slot < 0) {
+		lock_release (&shm_lock);
+		return false;
+	}
+	slot->swap_slot = swap_slot;
+	slot->frame = NULL;
+	while (!list_empty (&frame->rmap)) {
+		struct page *p = list_entry (list_front (&frame->rmap), struct page,
+				rmap_elem);
+		vm_page_unmap (p);
+	}
+	lock_release (&shm_lock);
+	return true;
+}
+
+/* Drops PAGE's mapping and its reference to the segment.  The frame is
+ * kept with the segment while anyone else refers to it. */
+static void
+shm_destroy (struct page *page) {
+	lock_acquire (&shm_lock);
+	if (page->frame != NULL)
+		vm_page_unmap (page);
+	shm_put (page->shm.seg);
+	lock_release (&shm_lock);
+}
@@ -2,4 +2,8 @@ vm_SRC = vm/vm.c          # Main api proxy
 vm_SRC += vm/uninit.c     # Uninitialized page
 vm_SRC += vm/anon.c       # Anonymous page
 vm_SRC += vm/file.c       # File mapped page
+vm_SRC += vm/zswap.c      # Compressed swap cache
+vm_SRC += vm/shm.c        # Shared memory segments
+vm_SRC += vm/replace.c    # Page replacement policies
+vm_SRC += vm/faultstat.c  # Page fault statistics
 vm_SRC += vm/inspect.c    # Testing utility
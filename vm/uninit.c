@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include <string.h>
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -56,6 +57,9 @@ uninit_initialize (struct page *page, void *kva) {
 	// (init ? init (page, aux) : true)의 결과를  -> init이 할당 되어 있으면 해당 init호출, 그렇지 않으면 true 리턴
 	// && 연산한 결과를 리턴
 	// 현재 단계에서 init은 lazy_load_segment() 함수로 설정
+	// init이 없는 page(스택 등)는 zero-fill이어야 한다. palloc은 frame을 0으로 채워주지 않는다.
+	if (init == NULL)
+		memset (kva, 0, PGSIZE);
 	return uninit->page_initializer (page, uninit->type, kva) && (init ? init (page, aux) : true);
 }
 
@@ -6,22 +6,50 @@
 #include "threads/vaddr.h"
 #include "include/userprog/process.h"
 #include "threads/mmu.h"
+#include <bitmap.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "intrinsic.h"
+#include "vm/faultstat.h"
+#include "vm/replace.h"
 
-uint64_t my_hash_function (const struct hash_elem *e, void *aux);
-bool my_less_func (const struct hash_elem *a,const struct hash_elem *b,void *aux);
-void hash_copy_func(struct hash_elem* elem, void *aux);
-void spt_dealloc(struct hash_elem *e, void *aux);
+static void spt_dealloc (struct page *page);
 
 struct list frame_table; // project3 vm_get_frame()
-struct list_elem* clock_ref; // project3 vm_get_victim()
 struct lock frame_table_lock;
 
+/* Fault-around: on a fault in a lazily loaded executable segment or file
+ * mapping, also map the other not-yet-loaded pages of the same one inside
+ * the aligned window of this many pages around the faulting page.  1
+ * disables it.
+ * Set with "-fa=N". */
+size_t fault_around_pages = 8;
+/* Whether mmap regions fault around as well.  Clear with "-no-fa-mmap"
+ * where pages of a mapping must be read from the file only when touched. */
+bool fault_around_mmap = true;
+/* Back 2 MB-aligned regions of untouched zero-filled anonymous pages with
+ * a single huge page.  Set with "-hugepages". */
+bool vm_hugepages = false;
+
+/* Most pages that may be locked with mlock(), over all processes.  The
+ * pager skips locked frames, so this keeps it from running out of
+ * victims.  Set with the "-mlock=PAGES" kernel option. */
+size_t mlock_limit = 64;
+static size_t locked_pages;	/* Protected by frame_table_lock. */
+static struct condition evict_done;	/* Some frame's eviction finished. */
+
+/* A single read-only frame of zeros, mapped for reads of anonymous pages
+ * that have never been written.  It is not in the frame table, so it is
+ * never evicted, and pages that map it are not in its rmap. */
+static struct frame *zero_frame;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */ 
 void
 vm_init (void) {
 	vm_anon_init ();
 	vm_file_init ();
+	vm_shm_init ();
 #ifdef EFILESYS  /* For project 4 */
 	pagecache_init ();
 #endif
@@ -29,8 +57,19 @@ vm_init (void) {
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
 	list_init(&frame_table);
-	clock_ref = list_begin(&frame_table);
 	lock_init(&frame_table_lock);
+	cond_init(&evict_done);
+	replace_init();
+
+	zero_frame = malloc (sizeof *zero_frame);
+	ASSERT (zero_frame != NULL);
+	zero_frame->kva = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	zero_frame->page = NULL;
+	list_init (&zero_frame->rmap);
+	zero_frame->refcnt = 1;
+	zero_frame->pin_cnt = 0;
+	zero_frame->evicting = false;
+	zero_frame->inode = NULL;
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -48,9 +87,14 @@ page_get_type (struct page *page) {
 }
 
 /* Helpers */
-static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
-static struct frame *vm_evict_frame (void);
+static bool vm_map_frame (struct page *page, struct frame *frame);
+static void vm_fault_around (struct page *page, struct container *c,
+		enum vm_type type);
+static bool vm_try_claim_huge (struct page *page);
+static bool vm_handle_fault (struct intr_frame *f, void *addr, bool user,
+		bool write, bool not_present, enum fault_class *cls);
+static struct frame *vm_evict_frame (struct thread *owner);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -89,7 +133,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		switch (VM_TYPE(type))
 		{
 		case VM_ANON:
-			new_initializer = anon_initializer;
+			new_initializer = type & VM_TEXT ? text_initializer : anon_initializer;
 			break;
 		case VM_FILE:
 			new_initializer = file_backed_initializer;
@@ -100,109 +144,242 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		uninit_new(new_page,upage,init,type,aux,new_initializer);
 
 		new_page->writable = writable;
+		new_page->owner = thread_current ();
 
-		return spt_insert_page(spt,new_page);
+		if (!spt_insert_page(spt,new_page)) {
+			free(new_page);
+			return false;
+		}
+		return true;
 	}
 	// vm_alloc_page_with_initializer는 무조건 uninit type의 page를 만든다. 그 후에 uninit_new에서 받아온 type으로 이 uninit type이 어떤 type으로 변할지와 같은 정보들을 page 구조체에 채워준다.
 err:
 	return false;
 }
 
+/* Returns the region of SPT that contains VA, or a null pointer if
+ * there is none.  In either case, stores in *POS the index at which a
+ * region starting at VA would be inserted. */
+static struct vma *
+spt_find_vma (struct supplemental_page_table *spt, void *va, size_t *pos) {
+	size_t lo = 0, hi = spt->vma_cnt;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		struct vma *vma = &spt->vmas[mid];
+		if (va < vma->start)
+			hi = mid;
+		else if (va >= vma->end)
+			lo = mid + 1;
+		else {
+			if (pos != NULL)
+				*pos = mid;
+			return vma;
+		}
+	}
+	if (pos != NULL)
+		*pos = lo;
+	return NULL;
+}
+
+/* Makes room for at least N slots in VMA. */
+static bool
+vma_reserve (struct vma *vma, size_t n) {
+	if (n <= vma->slot_cap)
+		return true;
+
+	size_t cap = vma->slot_cap ? vma->slot_cap * 2 : 8;
+	while (cap < n)
+		cap *= 2;
+	struct page **pages = realloc (vma->pages, cap * sizeof *pages);
+	if (pages == NULL)
+		return false;
+	vma->pages = pages;
+	vma->slot_cap = cap;
+	return true;
+}
+
 /* Find VA from spt and return page. On error, return NULL. */
 // SPT 에서 va에 해당하는 struct page를 찾는다 실패시 NULL 반환
-// 굳이 dummy page를 생성하는 이유는 dummy page를 생성하면 거기에 hash_elem이 있고, 이걸 통해서 우리가 받아온 va(offset을 지운)로 접근하기 위해서이다.
 struct page *
 spt_find_page (struct supplemental_page_table *spt, void *va ) {
 	// project3
-	/* TODO: Fill this function. */
-	struct page* page = (struct page*)malloc(sizeof(struct page));	// dummy page 생성
-	page->va = pg_round_down(va); // va가 가리키는 가상 page의 시작 포인트 (offset이 0으로 설정된 va)반환
-	struct hash_elem* target = hash_find(&spt->spt_hash,&page->hash_elem);
-	// SPT에서 hash_elem과 같은 요소를 검색해서 발견하면 elem 반환 아니면 NULL 반환
-	free(page);
-
-	if(target == NULL){
+	va = pg_round_down(va);
+	struct vma *vma = spt_find_vma(spt, va, NULL);
+	if(vma == NULL){
 		return NULL;
 	}
-	return hash_entry(target,struct page,hash_elem);
+	return vma->pages[pg_no(va) - pg_no(vma->start)];
 }
 
 /* Insert PAGE into spt with validation. */
 // spt에 va가 있는지 없는지 check
+// 바로 앞이나 뒤의 영역과 맞닿고 권한이 같으면 그 영역을 늘리고, 아니면 새 영역을 만든다.
 bool spt_insert_page (struct supplemental_page_table *spt,struct page *page) {
-	/* TODO: Fill this function. */
-	if (hash_insert(&spt->spt_hash,&page->hash_elem) == NULL){
+	void *va = page->va;
+	size_t pos;
+	struct vma *vma = spt_find_vma(spt, va, &pos);
+
+	if (vma != NULL) {
+		struct page **slot = &vma->pages[pg_no(va) - pg_no(vma->start)];
+		if (*slot != NULL)
+			return false;
+		*slot = page;
+		vma->page_cnt++;
 		return true;
 	}
-	return false;
+
+	/* Grow the region just below VA upward. */
+	vma = pos > 0 ? &spt->vmas[pos - 1] : NULL;
+	if (vma != NULL && vma->end == va && vma->writable == page->writable) {
+		size_t n = pg_no(vma->end) - pg_no(vma->start);
+		if (!vma_reserve(vma, n + 1))
+			return false;
+		vma->pages[n] = page;
+		vma->end += PGSIZE;
+		vma->page_cnt++;
+		return true;
+	}
+
+	/* Grow the region just above VA downward, as the stack does. */
+	vma = pos < spt->vma_cnt ? &spt->vmas[pos] : NULL;
+	if (vma != NULL && vma->start == va + PGSIZE
+			&& vma->writable == page->writable) {
+		size_t n = pg_no(vma->end) - pg_no(vma->start);
+		if (!vma_reserve(vma, n + 1))
+			return false;
+		memmove(vma->pages + 1, vma->pages, n * sizeof *vma->pages);
+		vma->pages[0] = page;
+		vma->start = va;
+		vma->page_cnt++;
+		return true;
+	}
+
+	/* Start a new region at POS. */
+	if (spt->vma_cnt == spt->vma_cap) {
+		size_t cap = spt->vma_cap ? spt->vma_cap * 2 : 8;
+		struct vma *vmas = realloc(spt->vmas, cap * sizeof *vmas);
+		if (vmas == NULL)
+			return false;
+		spt->vmas = vmas;
+		spt->vma_cap = cap;
+	}
+	vma = &spt->vmas[pos];
+	memmove(vma + 1, vma, (spt->vma_cnt - pos) * sizeof *vma);
+	spt->vma_cnt++;
+
+	vma->start = va;
+	vma->end = va + PGSIZE;
+	vma->writable = page->writable;
+	vma->page_cnt = 0;
+	vma->slot_cap = 0;
+	vma->pages = NULL;
+	if (!vma_reserve(vma, 1)) {
+		spt->vma_cnt--;
+		memmove(vma, vma + 1, (spt->vma_cnt - pos) * sizeof *vma);
+		return false;
+	}
+	vma->pages[0] = page;
+	vma->page_cnt = 1;
+	return true;
 }
 
 /* Delete PAGE into spt with validation. */
-// spt에 va가 있는지 없는지 check
+// spt에서 page를 빼기만 하고 해제하지는 않는다. 영역이 비면 영역도 없앤다.
 bool spt_delete_page (struct supplemental_page_table *spt,struct page *page) {
+	size_t pos;
+	struct vma *vma = spt_find_vma(spt, page->va, &pos);
+	if (vma == NULL)
+		return false;
 
-	/* TODO: Fill this function. */
-	if (hash_delete(&spt->spt_hash,&page->hash_elem) == NULL){
-		return true;
+	struct page **slot = &vma->pages[pg_no(page->va) - pg_no(vma->start)];
+	if (*slot != page)
+		return false;
+	*slot = NULL;
+	if (--vma->page_cnt == 0) {
+		free(vma->pages);
+		spt->vma_cnt--;
+		memmove(vma, vma + 1, (spt->vma_cnt - pos) * sizeof *vma);
 	}
-	return false;
+	return true;
 }
 
+/* Removes PAGE from SPT and frees it, along with its frame if it was the
+ * last page to map it. */
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
-	vm_dealloc_page (page);
-	return true;
+	spt_delete_page (spt, page);
+	spt_dealloc (page);
 }
 
-/* Get the struct frame, that will be evicted. */
-/* Project3 : Clock Algorithm */
-//page table entry가 최근에 액세스된 경우(즉, pml4_is_accessed에서 true가 반환되면) pml4_set_accessed 함수에서 accessed bit을 0으로 설정한다. 그리고 만약에 pml4에 page table entry가 없는 경우 (pml4_is_accessed에서 false 반환) 바로 그 frame이 victim(쫓겨날 대상)이 된다. 그리고 그 대상이 start에 기록된다.
-
-// 그리고 list의 맨 처음(list_begin)부터 한번 더 for문을 돌리면서 victim을 찾아낸다.
+/* Clears FRAME's evicting mark and wakes those waiting for it. */
+static void
+vm_evict_end (struct frame *frame) {
+	lock_acquire (&frame_table_lock);
+	frame->evicting = false;
+	cond_broadcast (&evict_done, &frame_table_lock);
+	lock_release (&frame_table_lock);
+}
 
-// 이 victim을 찾는 과정을 여러가지로 구현할 수 있지만 여기서는 clock algorithm으로 구현했다.
+/* Evict one page and return the corresponding frame.
+ * Return NULL on error.
+ * The victim is marked evicting while its pages are written out, which
+ * may sleep: until the mark is cleared, those pages are neither freed
+ * nor unmapped, see vm_page_settle(). */
 static struct frame *
-vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
-	struct thread* curr = thread_current();
-	lock_acquire(&frame_table_lock);
-	for (clock_ref; clock_ref != list_end(&frame_table); clock_ref = list_next(clock_ref)){
-		victim = list_entry(clock_ref,struct frame,frame_elem);
-		//bit가 1인 경우
-		if(pml4_is_accessed(curr->pml4,victim->page->va)){
-			pml4_set_accessed(curr->pml4,victim->page->va,0);
-		}else{
-			lock_release(&frame_table_lock);
-			return victim;
-		}
+vm_evict_frame (struct thread *owner) {
+	struct frame *victim = replace_pick_victim (owner);
+	if (victim == NULL) {
+		if (owner != NULL)
+			return NULL;
+		PANIC ("vm_evict_frame: every frame is pinned");
+	}
+	/* TODO: swap out the victim and return the evicted frame. */
+	ASSERT (victim->evicting);
+	if (!swap_out(victim->page)) {
+		/* Nowhere to put the page: it stays, and so does the frame. */
+		replace_on_map (victim);
+		vm_evict_end (victim);
+		if (owner != NULL)
+			return NULL;
+		PANIC ("vm_evict_frame: out of swap space");
 	}
 
-	struct list_elem* start = list_begin(&frame_table);
-
-	for (start; start != list_end(&frame_table); start = list_next(start)){
-		victim = list_entry(start,struct frame,frame_elem);
-		//bit가 1인 경우
-		if(pml4_is_accessed(curr->pml4,victim->page->va)){
-			pml4_set_accessed(curr->pml4,victim->page->va,0);
-		}else{
-			lock_release(&frame_table_lock);
-			return victim;
-		}
+	/* swap_out() has unmapped every page that used the frame. */
+	while (!list_empty (&victim->rmap)) {
+		struct page *page = list_entry (list_pop_front (&victim->rmap),
+				struct page, rmap_elem);
+		page->frame = NULL;
+		rss_evicted (page);
 	}
-	lock_release(&frame_table_lock);
-	ASSERT(clock_ref != NULL);
+	thread_current ()->evict_caused++;
+	victim->refcnt = 0;
+	victim->pin_cnt = 0;
+	victim->page = NULL;
+	vm_evict_end (victim);
 	return victim;
 }
 
-/* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+/* Wraps KVA, a page from the user pool, in a new frame table entry. */
 static struct frame *
-vm_evict_frame (void) {
-	struct frame *victim = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
-	swap_out(victim->page);
-	return victim;
+vm_frame_new (void *kva) {
+	struct frame *frame = (struct frame*)malloc(sizeof(struct frame));
+	if (frame == NULL) {
+		palloc_free_page(kva);
+		return NULL;
+	}
+	frame->kva = kva;
+	frame->page = NULL; //새 frame을 가져왔으니 page의 멤버를 초기화
+	list_init(&frame->rmap);
+	frame->refcnt = 0;
+	frame->pin_cnt = 0;
+	frame->evicting = false;
+	frame->repl_tracked = false;
+	frame->inode = NULL;
+	lock_acquire(&frame_table_lock);
+	list_push_back(&frame_table,&frame->frame_elem);
+	lock_release(&frame_table_lock);
+	return frame;
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
@@ -210,38 +387,152 @@ vm_evict_frame (void) {
  * memory is full, this function evicts the frame to get the available memory
  * space.*/
 /* Frame_Table에 할당받은 Frame을 추가해준다.*/
-static struct frame *
+struct frame *
 vm_get_frame (void) {
-	struct frame *frame = (struct frame*)malloc(sizeof(struct frame)); // user_pool 에서 frame 가져오고, kva return해서 frame에 넣어준다.
+	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
-	frame->kva = palloc_get_page(PAL_USER);
-	if(frame->kva == NULL){ //frame에서 가용한 page가 없다면
+	// resident limit에 닿은 프로세스는 빈 frame이 있어도 자기 frame을 내보내고 그 자리를 쓴다.
+	struct thread *curr = thread_current();
+	if (rss_at_limit(curr) && (frame = vm_evict_frame(curr)) != NULL) {
+		frame->page = NULL;
+		return frame;
+	}
+	void *kva = palloc_get_page(PAL_USER); // user_pool 에서 frame 가져오고, kva return해서 frame에 넣어준다.
+	if(kva == NULL){ //frame에서 가용한 page가 없다면
 		/* 해당 로직은 evict한 frame을 받아오기에 이미 Frame_Table 존재해서 list_push_back()할 필요 없음 */
-		frame = vm_evict_frame(); // 쫓아냄
+		frame = vm_evict_frame(NULL); // 쫓아냄
 		frame->page = NULL;
 		return frame;
 	}
-	lock_acquire(&frame_table_lock);
-	list_push_back(&frame_table,&frame->frame_elem);
-	lock_release(&frame_table_lock);
-	frame->page = NULL; //새 frame을 가져왔으니 page의 멤버를 초기화
+	frame = vm_frame_new(kva);
 	ASSERT (frame != NULL);
 	ASSERT (frame->page == NULL);
 	return frame;
 }
 
+/* Records that PAGE maps FRAME. */
+void
+vm_frame_link (struct frame *frame, struct page *page) {
+	list_push_back (&frame->rmap, &page->rmap_elem);
+	frame->refcnt++;
+	rss_charge (page->owner, 1);
+	if (page->locked)
+		frame->pin_cnt++;
+	page->frame = frame;
+	if (frame->page == NULL) {
+		frame->page = page;
+		replace_on_map (frame);
+	}
+}
+
+/* Removes PAGE's mapping of its frame from its owner's page table and
+ * from the frame's rmap.  Returns the number of pages that still map the
+ * frame; the caller frees the frame with vm_frame_free() at 0. */
+int
+vm_page_unmap (struct page *page) {
+	struct frame *frame = page->frame;
+
+	ASSERT (frame != NULL);
+	if (page->owner->pml4 != NULL)
+		pml4_clear_page (page->owner->pml4, page->va);
+	if (frame == zero_frame) {
+		/* Not tracked, and never freed. */
+		page->frame = NULL;
+		return frame->refcnt;
+	}
+	list_remove (&page->rmap_elem);
+	rss_charge (page->owner, -1);
+	page->frame = NULL;
+	if (frame->page == page)
+		frame->page = list_empty (&frame->rmap) ? NULL
+			: list_entry (list_front (&frame->rmap), struct page, rmap_elem);
+	if (frame->page == NULL)
+		replace_on_unmap (frame);
+	/* Unpin only now, so that the policy never picks a frame that has
+	 * no page left. */
+	if (page->locked || page->pinned)
+		frame->pin_cnt--;
+	page->pinned = false;
+	return --frame->refcnt;
+}
+
+/* Waits until the pager is done with PAGE's frame, if it is evicting
+ * it, and returns PAGE's frame then.  Caller holds frame_table_lock. */
+static struct frame *
+vm_page_wait_evict (struct page *page) {
+	struct frame *frame;
+
+	while ((frame = page->frame) != NULL && frame->evicting)
+		cond_wait (&evict_done, &frame_table_lock);
+	return frame;
+}
+
+/* Prepares PAGE to be unmapped for good.  Waits until the pager is done
+ * with PAGE's frame if it is evicting it, and then pins the frame, so
+ * that it is not picked again before vm_page_unmap().  Afterwards PAGE's
+ * frame is NULL if eviction took it. */
+void
+vm_page_settle (struct page *page) {
+	lock_acquire (&frame_table_lock);
+	struct frame *frame = vm_page_wait_evict (page);
+	if (frame != NULL && frame != zero_frame && !page->locked
+			&& !page->pinned) {
+		frame->pin_cnt++;
+		page->pinned = true;
+	}
+	lock_release (&frame_table_lock);
+}
+
+/* Removes FRAME, which no page maps any more, from the frame table and
+ * returns its memory to the user pool. */
+void
+vm_frame_free (struct frame *frame) {
+	ASSERT (frame->refcnt == 0);
+
+	lock_acquire (&frame_table_lock);
+	list_remove (&frame->frame_elem);
+	lock_release (&frame_table_lock);
+	palloc_free_page (frame->kva);
+	free (frame);
+}
+
 /* Growing the stack. */
-static void
+static bool
 vm_stack_growth (void *addr UNUSED) {
 	if (vm_alloc_page(VM_ANON|VM_MARKER_0, addr, 1)) {
 		
 		//vm_claim_page(addr);
 		thread_current()->stack_bottom -= PGSIZE;
+		return true;
 	}
+	return false;
 }
 /* Handle the fault on write_protected page */
+/* The only writable pages that are mapped read-only are those that map
+ * the zero frame: give PAGE a private zeroed frame on its first write. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	if (page->frame != zero_frame)
+		return false;
+
+	struct frame *frame = vm_get_frame ();
+	memset (frame->kva, 0, PGSIZE);
+	vm_page_unmap (page);
+	vm_frame_link (frame, page);
+	return pml4_set_page (page->owner->pml4, page->va, frame->kva, true);
+}
+
+static bool is_zero_fill_anon (struct page *p);
+
+/* Maps the zero frame read-only at PAGE, an unloaded zero-fill anonymous
+ * page that is being read, without allocating a frame. */
+static bool
+vm_map_zero_page (struct page *page) {
+	if (!page->uninit.page_initializer (page, page->uninit.type,
+				zero_frame->kva))
+		return false;
+	page->frame = zero_frame;
+	return pml4_set_page (page->owner->pml4, page->va, zero_frame->kva, false);
 }
 
 /* Return true on success */
@@ -252,6 +543,19 @@ vm_handle_wp (struct page *page UNUSED) {
 // 3. 확인되면 vm_stack_growth 호출
 bool
 vm_try_handle_fault (struct intr_frame *f , void *addr ,bool user , bool write , bool not_present) {
+	// 모든 fault를 종류별로 세고, 처리에 걸린 TSC cycle을 기록한다.
+	enum fault_class cls = FAULT_BAD;
+	uint64_t start = rdtsc ();
+	bool success = vm_handle_fault (f, addr, user, write, not_present, &cls);
+	faultstat_record (success ? cls : FAULT_BAD, rdtsc () - start);
+	return success;
+}
+
+/* Handles the fault for vm_try_handle_fault() and stores its class in
+ * *CLS. */
+static bool
+vm_handle_fault (struct intr_frame *f, void *addr, bool user, bool write,
+		bool not_present, enum fault_class *cls) {
 	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
 	struct page *page = NULL;
 
@@ -263,9 +567,10 @@ vm_try_handle_fault (struct intr_frame *f , void *addr ,bool user , bool write ,
 		// thread 구조체 내의 rsp_stack을 설정 
 		struct thread* cur = thread_current();
 		void *rsp_stack = !user ? cur->rsp_stack : f->rsp;
+		bool grew = false;
 
 		if (rsp_stack-8 <= addr  && USER_STACK - 0x100000 <= addr && addr <= USER_STACK){
-				vm_stack_growth(pg_round_down(addr));
+				grew = vm_stack_growth(pg_round_down(addr));
 		} 
 		page = spt_find_page(spt,addr);
 		if(page == NULL){
@@ -274,12 +579,57 @@ vm_try_handle_fault (struct intr_frame *f , void *addr ,bool user , bool write ,
 		if(write && !page->writable){
 			return false;
 		}
+		// pager가 이 page를 내보내는 중이면 PTE는 이미 끊겼어도 page는 아직 frame의 rmap에 있다.
+		// 끝날 때까지 기다린 뒤 다시 확인한다. (내보내기에 실패했으면 매핑이 되돌려져 있다)
+		lock_acquire(&frame_table_lock);
+		vm_page_wait_evict(page);
+		lock_release(&frame_table_lock);
+		// 이미 매핑되어 있으면 할 일이 없다.
+		if (pml4_get_page(cur->pml4, addr) != NULL) {
+			*cls = FAULT_SPURIOUS;
+			return true;
+		}
+		if (!write && is_zero_fill_anon (page)) {
+			*cls = grew ? FAULT_STACK : FAULT_ZERO;
+			return vm_map_zero_page (page);
+		}
+
+		bool loaded = VM_TYPE(page->operations->type) != VM_UNINIT;
+		enum vm_type full_type = loaded ? page->operations->type : page->uninit.type;
+		if (grew)
+			*cls = FAULT_STACK;
+		else if (full_type & VM_TEXT)
+			*cls = FAULT_TEXT;
+		else if (loaded)
+			*cls = FAULT_SWAP;
+		else
+			*cls = VM_TYPE(full_type) == VM_FILE ? FAULT_FILE : FAULT_ANON;
+
+		// 아직 로드되지 않은 세그먼트/mmap 페이지라면 claim 전에 container를 챙겨둔다.
+		// (claim 과정에서 page->uninit이 덮어써진다)
+		struct container *aux = NULL;
+		enum vm_type type = VM_UNINIT;
+		if (VM_TYPE(page->operations->type) == VM_UNINIT
+				&& page->uninit.init == lazy_load_segment) {
+			aux = page->uninit.aux;
+			type = page->uninit.type;
+		}
+		if (vm_hugepages && vm_try_claim_huge(page))
+			return true;
 		if (!vm_do_claim_page(page)){
 			return false;
 		}
+		if (aux != NULL)
+			vm_fault_around(page, aux, type);
 		return true;
 	}
-	return false;
+
+	// present인데 fault가 난 경우: 읽기 전용 zero page에 처음 쓰는 경우만 처리한다.
+	page = spt_find_page(spt, addr);
+	if (page == NULL || !write || !page->writable)
+		return false;
+	*cls = FAULT_COW;
+	return vm_handle_wp (page);
 
 
 		// /* TODO: Validate the fault */
@@ -287,6 +637,471 @@ vm_try_handle_fault (struct intr_frame *f , void *addr ,bool user , bool write ,
 
 }
 
+/* Returns true if P is a not-yet-loaded page that continues the same
+ * segment or mapping as PAGE, whose contents are described by C. */
+static bool
+fault_around_eligible (struct page *page, struct container *c,
+		enum vm_type type, struct page *p) {
+	if (p == NULL || VM_TYPE(p->operations->type) != VM_UNINIT
+			|| p->uninit.init != lazy_load_segment
+			|| VM_TYPE(p->uninit.type) != VM_TYPE(type)
+			|| p->writable != page->writable)
+		return false;
+
+	struct container *pc = p->uninit.aux;
+	if (pc->file != c->file
+			|| pc->offset != c->offset + (off_t) ((uint8_t *) p->va - (uint8_t *) page->va)
+			|| pc->read_bytes == 0)
+		return false;
+
+	/* A writable segment page that the file does not fill completely may
+	 * hold the start of .bss, which must stay unloaded until touched. */
+	if (VM_TYPE(type) == VM_ANON && p->writable && pc->read_bytes != PGSIZE)
+		return false;
+	return true;
+}
+
+/* Most pages read with one file_read_at() by fault-around. */
+#define FAULT_AROUND_CLUSTER 16
+
+/* Reads the N pages of RUN, which continue each other in the file, into
+ * N contiguous free frames with a single file_read_at() and maps them.
+ * Returns false if there were no such frames or the read failed. */
+static bool
+fault_around_run (struct page **run, size_t n) {
+	struct container *c = run[0]->uninit.aux;
+	size_t bytes = (n - 1) * PGSIZE
+		+ ((struct container *) run[n - 1]->uninit.aux)->read_bytes;
+
+	uint8_t *kva = palloc_get_multiple (PAL_USER, n);
+	if (kva == NULL)
+		return false;
+	if (file_read_at (c->file, kva, bytes, c->offset) != (off_t) bytes) {
+		palloc_free_multiple (kva, n);
+		return false;
+	}
+	memset (kva + bytes, 0, n * PGSIZE - bytes);
+
+	for (size_t i = 0; i < n; i++) {
+		struct page *p = run[i];
+
+		/* vm_frame_new() frees the page when it fails. */
+		struct frame *frame = vm_frame_new (kva + i * PGSIZE);
+		if (frame == NULL) {
+			while (++i < n)
+				palloc_free_page (kva + i * PGSIZE);
+			return false;
+		}
+		p->uninit.page_initializer (p, p->uninit.type, frame->kva);
+		vm_frame_link (frame, p);
+		pml4_set_page (p->owner->pml4, p->va, frame->kva, p->writable);
+		if (p->operations->type & VM_TEXT)
+			text_publish (p);
+	}
+	return true;
+}
+
+/* Maps the neighbours of PAGE, which was just loaded from the file
+ * described by C, that are eligible for fault-around.  Each run of
+ * neighbours that continue each other is read with one file_read_at().
+ * Only free frames are used: reading ahead is never worth an eviction. */
+static void
+vm_fault_around (struct page *page, struct container *c, enum vm_type type) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *run[FAULT_AROUND_CLUSTER];
+	size_t n = 0;
+
+	size_t window = fault_around_pages;
+	uint8_t *start;
+
+	if (page->advice == MADV_RANDOM)
+		return;
+	if (page->advice == MADV_SEQUENTIAL) {
+		/* Read only ahead of the fault, and further. */
+		window *= 4;
+		if (window <= 1)
+			return;
+		start = page->va;
+	} else {
+		if (window <= 1)
+			return;
+		if (VM_TYPE(type) == VM_FILE && !fault_around_mmap)
+			return;
+		start = (uint8_t *) page->va
+			- ((uint64_t) page->va / PGSIZE % window) * PGSIZE;
+	}
+	for (size_t i = 0; i <= window; i++) {
+		uint8_t *va = start + i * PGSIZE;
+		struct page *p = NULL;
+
+		if (i < window && va != page->va) {
+			p = spt_find_page (spt, va);
+			/* Text another process already loaded is shared instead. */
+			if (!fault_around_eligible (page, c, type, p) || text_attach (p))
+				p = NULL;
+		}
+		if (p != NULL)
+			run[n++] = p;
+
+		/* A run ends at a gap, at a page the file does not fill, or when
+		 * it is full. */
+		if (n > 0 && (p == NULL || n == FAULT_AROUND_CLUSTER
+				|| ((struct container *) p->uninit.aux)->read_bytes != PGSIZE)) {
+			if (!fault_around_run (run, n))
+				return;
+			n = 0;
+		}
+	}
+}
+
+/* Most pages read with one file_read_at() by vm_populate(). */
+#define POPULATE_CLUSTER 16
+
+/* Returns true if P is an unloaded page of a file mapping. */
+static bool
+populate_eligible (struct page *p) {
+	return p != NULL && VM_TYPE(p->operations->type) == VM_UNINIT
+		&& VM_TYPE(p->uninit.type) == VM_FILE
+		&& p->uninit.init == lazy_load_segment;
+}
+
+/* Loads and maps the unloaded pages of the file mapping from ADDR to
+ * ADDR + LENGTH now, for MAP_POPULATE.  Pages that continue each other in
+ * the file are read with one file_read_at() per run.  Like fault-around,
+ * only free frames are used: from the first page that finds none, the
+ * rest of the range is left to fault in lazily. */
+void
+vm_populate (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *end = pg_round_up ((uint8_t *) addr + length);
+	struct page *run[POPULATE_CLUSTER];
+	void *kvas[POPULATE_CLUSTER];
+	bool out_of_frames = false;
+
+	uint8_t *buf = palloc_get_multiple (0, POPULATE_CLUSTER);
+	if (buf == NULL)
+		return;
+
+	uint8_t *va = addr;
+	while (va < end && !out_of_frames) {
+		struct page *p = spt_find_page (spt, va);
+		if (!populate_eligible (p)) {
+			va += PGSIZE;
+			continue;
+		}
+
+		struct container *c = p->uninit.aux;
+		struct file *file = c->file;
+		off_t offset = c->offset;
+		size_t n = 0, bytes = 0;
+		while (n < POPULATE_CLUSTER && va < end) {
+			p = spt_find_page (spt, va);
+			if (!populate_eligible (p))
+				break;
+			c = p->uninit.aux;
+			if (c->file != file || c->offset != offset + (off_t) bytes
+					|| bytes != n * PGSIZE)
+				break;
+			void *kva = palloc_get_page (PAL_USER);
+			if (kva == NULL) {
+				out_of_frames = true;
+				break;
+			}
+			run[n] = p;
+			kvas[n++] = kva;
+			bytes += c->read_bytes;
+			va += PGSIZE;
+		}
+
+		size_t i = 0;
+		bool ok = file_read_at (file, buf, bytes, offset) == (off_t) bytes;
+		for (; ok && i < n; i++) {
+			p = run[i];
+			size_t read_bytes = ((struct container *) p->uninit.aux)->read_bytes;
+			memcpy (kvas[i], buf + i * PGSIZE, read_bytes);
+			memset ((uint8_t *) kvas[i] + read_bytes, 0, PGSIZE - read_bytes);
+
+			/* vm_frame_new() frees the page when it fails. */
+			struct frame *frame = vm_frame_new (kvas[i]);
+			if (frame == NULL) {
+				ok = false;
+				i++;
+				break;
+			}
+			p->uninit.page_initializer (p, p->uninit.type, frame->kva);
+			vm_frame_link (frame, p);
+			pml4_set_page (p->owner->pml4, p->va, frame->kva, p->writable);
+		}
+		if (!ok) {
+			/* Leave the rest of the run, and the range, lazy. */
+			for (; i < n; i++)
+				palloc_free_page (kvas[i]);
+			break;
+		}
+	}
+	palloc_free_multiple (buf, POPULATE_CLUSTER);
+}
+
+/* Returns true if P is an unloaded anonymous page whose first contents
+ * are all zeros, such as a stack or .bss page. */
+static bool
+is_zero_fill_anon (struct page *p) {
+	if (p == NULL || VM_TYPE(p->operations->type) != VM_UNINIT
+			|| VM_TYPE(p->uninit.type) != VM_ANON)
+		return false;
+	if (p->uninit.init == NULL)
+		return true;
+	return p->uninit.init == lazy_load_segment
+		&& ((struct container *) p->uninit.aux)->read_bytes == 0;
+}
+
+/* Tries to load the whole 2 MB-aligned region around PAGE at once and map
+ * it with one huge page.  Every page of the region must be an unloaded
+ * zero-filled anonymous page with PAGE's protection.  The pages keep
+ * their own frame table entries, so evicting one of them later just
+ * splits the mapping. */
+static bool
+vm_try_claim_huge (struct page *page) {
+	struct thread *curr = thread_current ();
+	uint8_t *base = huge_round_down (page->va);
+	struct list frames;
+
+	for (size_t i = 0; i < HUGE_PGCNT; i++) {
+		struct page *p = spt_find_page (&curr->spt, base + i * PGSIZE);
+		if (!is_zero_fill_anon (p) || p->writable != page->writable)
+			return false;
+	}
+
+	uint8_t *kva = palloc_get_huge_page (PAL_USER | PAL_ZERO);
+	if (kva == NULL)
+		return false;
+
+	/* Allocate every frame up front so that nothing needs undoing once
+	 * pages start to change state. */
+	list_init (&frames);
+	for (size_t i = 0; i < HUGE_PGCNT; i++) {
+		struct frame *frame = malloc (sizeof *frame);
+		if (frame == NULL) {
+			while (!list_empty (&frames))
+				free (list_entry (list_pop_front (&frames), struct frame,
+							frame_elem));
+			palloc_free_multiple (kva, HUGE_PGCNT);
+			return false;
+		}
+		frame->kva = kva + i * PGSIZE;
+		frame->page = NULL;
+		list_init (&frame->rmap);
+		frame->refcnt = 0;
+		frame->pin_cnt = 0;
+		frame->evicting = false;
+		frame->repl_tracked = false;
+		frame->inode = NULL;
+		list_push_back (&frames, &frame->frame_elem);
+	}
+
+	/* Map the region before any page changes state: if the mapping
+	 * cannot be made, everything is still ours to free and the fault
+	 * is handled with a 4 kB page instead.  Nothing runs in the process
+	 * until the frames below are filled. */
+	if (!pml4_set_huge_page (curr->pml4, base, kva, page->writable)) {
+		while (!list_empty (&frames))
+			free (list_entry (list_pop_front (&frames), struct frame,
+						frame_elem));
+		palloc_free_multiple (kva, HUGE_PGCNT);
+		return false;
+	}
+
+	for (size_t i = 0; i < HUGE_PGCNT; i++) {
+		struct page *p = spt_find_page (&curr->spt, base + i * PGSIZE);
+		struct frame *frame = list_entry (list_pop_front (&frames),
+				struct frame, frame_elem);
+		vm_frame_link (frame, p);
+		lock_acquire (&frame_table_lock);
+		list_push_back (&frame_table, &frame->frame_elem);
+		lock_release (&frame_table_lock);
+		/* Zero-fill anonymous pages only clear the frame, which PAL_ZERO
+		 * already did, so loading them cannot fail. */
+		bool loaded = swap_in (p, frame->kva);
+		ASSERT (loaded);
+	}
+	return true;
+}
+
+/* Returns true if every page from START up to END is in the current
+ * process's SPT and, if UNLOCKED, none of them is locked. */
+static bool
+vm_range_valid (uint8_t *start, uint8_t *end, bool unlocked) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+
+	for (uint8_t *va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		if (page == NULL || (unlocked && page->locked))
+			return false;
+	}
+	return true;
+}
+
+/* Throws away the contents of PAGE for MADV_DONTNEED.  A dirty file page
+ * is written back first and read again on its next access; an anonymous
+ * page reads back as zeros.  Text and shared memory are shared, so they
+ * are kept. */
+static void
+vm_page_drop (struct page *page) {
+	enum vm_type type = page->operations->type;
+	struct frame *frame;
+
+	if (VM_TYPE (type) == VM_UNINIT || (type & (VM_TEXT | VM_SHM)))
+		return;
+
+	vm_page_settle (page);
+	frame = page->frame;
+	if (VM_TYPE (type) == VM_FILE) {
+		if (frame == NULL)
+			return;
+		swap_out (page);
+		if (vm_page_unmap (page) == 0)
+			vm_frame_free (frame);
+		return;
+	}
+
+	destroy (page);
+	if (frame != NULL && vm_page_unmap (page) == 0)
+		vm_frame_free (frame);
+
+	struct thread *owner = page->owner;
+	bool writable = page->writable;
+	uint8_t advice = page->advice;
+	uninit_new (page, page->va, NULL, VM_ANON, NULL, anon_initializer);
+	page->owner = owner;
+	page->writable = writable;
+	page->advice = advice;
+}
+
+/* Applies ADVICE, one of MADV_*, to the pages from ADDR to ADDR + LENGTH.
+ * ADDR must be page-aligned and every page must be mapped.  Returns 0 on
+ * success, -1 on error. */
+int
+vm_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = addr;
+	uint8_t *end = pg_round_up (start + length);
+
+	if (pg_ofs (addr) != 0 || advice < MADV_NORMAL || advice > MADV_DONTNEED)
+		return -1;
+	if (!vm_range_valid (start, end, advice == MADV_DONTNEED))
+		return -1;
+
+	for (uint8_t *va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+
+		switch (advice) {
+			case MADV_WILLNEED:
+				/* A hint: a page that cannot be loaded now faults later. */
+				if (page->frame == NULL && !is_zero_fill_anon (page))
+					vm_do_claim_page (page);
+				break;
+			case MADV_DONTNEED:
+				vm_page_drop (page);
+				break;
+			default:
+				page->advice = advice;
+				break;
+		}
+	}
+	return 0;
+}
+
+/* Unlocks PAGE, unpinning the frame it holds. */
+static void
+vm_page_unlock (struct page *page) {
+	if (page->frame != NULL && page->frame != zero_frame)
+		page->frame->pin_cnt--;
+	page->locked = false;
+}
+
+/* Locks (if LOCK) or unlocks the pages that overlap ADDR to ADDR + LENGTH.
+ * Locking loads each page and keeps its frame from being evicted until it
+ * is unlocked or unmapped.  Returns 0 on success, -1 if a page is not
+ * mapped, locking would exceed mlock_limit or a page cannot be loaded;
+ * on failure no page is left locked by this call. */
+int
+vm_mlock (void *addr, size_t length, bool lock) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = pg_round_down (addr);
+	uint8_t *end = pg_round_up ((uint8_t *) addr + length);
+	size_t cnt = 0;
+
+	if (!vm_range_valid (start, end, false))
+		return -1;
+
+	if (!lock) {
+		for (uint8_t *va = start; va < end; va += PGSIZE) {
+			struct page *page = spt_find_page (spt, va);
+			if (page->locked) {
+				vm_page_unlock (page);
+				cnt++;
+			}
+		}
+		lock_acquire (&frame_table_lock);
+		locked_pages -= cnt;
+		lock_release (&frame_table_lock);
+		return 0;
+	}
+
+	/* Remember which pages this call locks, to undo them on failure. */
+	struct bitmap *fresh = bitmap_create ((end - start) / PGSIZE);
+	if (fresh == NULL)
+		return -1;
+	for (uint8_t *va = start; va < end; va += PGSIZE)
+		if (!spt_find_page (spt, va)->locked) {
+			bitmap_mark (fresh, (va - start) / PGSIZE);
+			cnt++;
+		}
+	lock_acquire (&frame_table_lock);
+	if (locked_pages + cnt > mlock_limit) {
+		lock_release (&frame_table_lock);
+		bitmap_destroy (fresh);
+		return -1;
+	}
+	locked_pages += cnt;
+	lock_release (&frame_table_lock);
+
+	uint8_t *va;
+	for (va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+		if (page->locked)
+			continue;
+
+		/* A frame being evicted would drop the pin: wait for it. */
+		bool ok = true;
+		lock_acquire (&frame_table_lock);
+		struct frame *frame = vm_page_wait_evict (page);
+		page->locked = true;
+		if (frame != NULL && frame != zero_frame)
+			frame->pin_cnt++;
+		lock_release (&frame_table_lock);
+		if (frame == NULL)
+			ok = vm_do_claim_page (page);          /* Linking pins it. */
+		else if (frame == zero_frame && page->writable)
+			ok = vm_handle_wp (page);              /* Private copy, pinned. */
+		/* A read-only page on the zero frame is never evicted anyway. */
+		if (!ok)
+			break;
+	}
+
+	if (va < end) {
+		/* VA could not be loaded: unlock it and those locked before it. */
+		for (uint8_t *p = start; p <= va; p += PGSIZE)
+			if (bitmap_test (fresh, (p - start) / PGSIZE))
+				vm_page_unlock (spt_find_page (spt, p));
+		lock_acquire (&frame_table_lock);
+		locked_pages -= cnt;
+		lock_release (&frame_table_lock);
+	}
+	bitmap_destroy (fresh);
+	return va < end ? -1 : 0;
+}
+
 /* Free the page.
  * DO NOT MODIFY THIS FUNCTION. */
 void
@@ -315,17 +1130,33 @@ vm_claim_page (void *va) {
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	/* Text already loaded by another process is mapped, not read again. */
+	if (text_attach (page))
+		return true;
+	/* Shared memory maps the segment's frame, whoever loads it. */
+	if (page->operations->type & VM_SHM)
+		return shm_claim (page);
+	return vm_map_frame (page, vm_get_frame ());
+}
 
+/* Maps PAGE to FRAME and loads its contents. */
+static bool
+vm_map_frame (struct page *page, struct frame *frame) {
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	vm_frame_link (frame, page);
 
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 	//  user virtual address(UPAGE)에서 kernel virtual address(KPAGE)로의 mapping을 page table에 추가해주는 함수다(pml4 mapping 진행).
 	// 인자로 받는 writable이 true면 user process가 page를 수정할 수 있고, 그렇지 않으면 read-only이다. KPAGE는 user pool에서 가져온 page여야 한다. UPAGE가 이미 mapping되었거나, 메모리 할당이 실패하면 false를 반환한다. 성공하면 true를 반환한다. 성공시에 swap_in()함수가 실행된다.
-	if(install_page(page->va,frame->kva,page->writable)){
-		return swap_in (page, frame->kva);
+	// fork 중에는 부모의 page를 자식 스레드가 올릴 수 있으므로 현재 스레드가 아니라 page 소유자의 page table에 매핑한다.
+	uint64_t *pml4 = page->owner->pml4;
+	if(pml4_get_page(pml4,page->va) == NULL
+			&& pml4_set_page(pml4,page->va,frame->kva,page->writable)){
+		if (!swap_in (page, frame->kva))
+			return false;
+		if (page->operations->type & VM_TEXT)
+			text_publish (page);
+		return true;
 	}
 	return false;
 }
@@ -333,23 +1164,9 @@ vm_do_claim_page (struct page *page) {
 /* Initialize new supplemental page table */
 void
 supplemental_page_table_init (struct supplemental_page_table *spt) {
-	hash_init(&spt->spt_hash,my_hash_function,my_less_func,NULL);
-}
-//project3
-// page에 대한 hash value를 return 해준다.(hash값을 구해주는 함수의 pointer)
-// key = va, value = hash_elem
-uint64_t my_hash_function (const struct hash_elem *e, void *aux){
-	struct page* page = hash_entry(e,struct page,hash_elem);
-	return hash_bytes(&page->va,sizeof(page->va)); //va에서 시작하는 hash를 반환
-}
-
-
-bool my_less_func (const struct hash_elem *a,const struct hash_elem *b,void *aux){
-	bool flag = false;
-	/* Returns true if A is less than B, or false if A is greater than or equal to B */
-	struct page* A = hash_entry(a,struct page,hash_elem);
-	struct page* B = hash_entry(b,struct page,hash_elem);
-	return A->va < B->va;
+	spt->vmas = NULL;
+	spt->vma_cnt = 0;
+	spt->vma_cap = 0;
 }
 
 /* Copy supplemental page table from src to dst */
@@ -359,10 +1176,13 @@ bool my_less_func (const struct hash_elem *a,const struct hash_elem *b,void *aux
 // uninit 페이지를 할당하고 즉시 요청해야 합니다.
 
 bool supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED, struct supplemental_page_table *src UNUSED) {
-    struct hash_iterator i;
-    hash_first (&i, &src->spt_hash);
-    while (hash_next (&i)) {	// src의 각각의 페이지를 반복문을 통해 복사
-        struct page *parent_page = hash_entry (hash_cur (&i), struct page, hash_elem);   // 현재 해시 테이블의 element 리턴
+    for (size_t v = 0; v < src->vma_cnt; v++) {
+      struct vma *vma = &src->vmas[v];
+      size_t n = pg_no(vma->end) - pg_no(vma->start);
+      for (size_t i = 0; i < n; i++) {	// src의 각각의 페이지를 반복문을 통해 복사
+        struct page *parent_page = vma->pages[i];
+        if (parent_page == NULL)
+            continue;
         enum vm_type type = page_get_type(parent_page);		// 부모 페이지의 type
         void *upage = parent_page->va;						// 부모 페이지의 가상 주소
         bool writable = parent_page->writable;				// 부모 페이지의 쓰기 가능 여부
@@ -370,10 +1190,36 @@ bool supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED, s
         void* aux = parent_page->uninit.aux;
 
         if(parent_page->operations->type == VM_UNINIT) {	// 부모 타입이 uninit인 경우
-            if(!vm_alloc_page_with_initializer(type, upage, writable, init, aux)) // 부모의 타입, 부모의 페이지 va, 부모의 writable, 부모의 uninit.init, 부모의 aux (container)
+            // VM_TEXT 같은 marker도 유지해야 하므로 uninit.type을 그대로 넘긴다.
+            if(!vm_alloc_page_with_initializer(parent_page->uninit.type, upage, writable, init, aux)) // 부모의 타입, 부모의 페이지 va, 부모의 writable, 부모의 uninit.init, 부모의 aux (container)
+                return false;
+        }
+        else if (parent_page->operations->type & VM_TEXT) {
+            // 실행 코드는 복사하지 않고, 자식이 처음 접근할 때 부모의 frame을 공유한다.
+            struct container *c = malloc (sizeof *c);
+            if (c == NULL)
+                return false;
+            c->file = parent_page->text.file;
+            c->offset = parent_page->text.offset;
+            c->read_bytes = parent_page->text.read_bytes;
+            if (!vm_alloc_page_with_initializer (VM_ANON | VM_TEXT, upage,
+                        writable, lazy_load_segment, c))
+                return false;
+        }
+        else if (parent_page->operations->type & VM_SHM) {
+            // 공유 메모리는 복사하지 않고 자식도 같은 segment를 붙인다.
+            if (!shm_fork (parent_page))
+                return false;
+        }
+        else if (parent_page->frame == zero_frame) {
+            // 한 번도 쓰지 않은 page는 자식에서도 zero-fill 상태로 둔다.
+            if (!vm_alloc_page(VM_ANON, upage, writable))
                 return false;
         }
         else {
+            // 스왑 아웃된 부모 page는 복사하기 전에 다시 올린다. (부모는 fork가 끝날 때까지 기다리고 있다)
+            if (parent_page->frame == NULL && !vm_do_claim_page(parent_page))
+                return false;
             if(!vm_alloc_page(type, upage, writable))
                 return false;
             if(!vm_claim_page(upage))
@@ -381,6 +1227,9 @@ bool supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED, s
 			struct page* child_page = spt_find_page(dst, upage);
             memcpy(child_page->frame->kva, parent_page->frame->kva, PGSIZE);
         }
+        // madvise() 힌트는 물려주고, mlock()은 물려주지 않는다.
+        spt_find_page(dst, upage)->advice = parent_page->advice;
+      }
     }
     return true;
 }
@@ -390,25 +1239,60 @@ void
 supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */
-	struct hash_iterator i;
-	struct frame* frame;
-    hash_first (&i, &spt->spt_hash);
-	while (hash_next(&i)){
-		struct page *target = hash_entry (hash_cur (&i), struct page, hash_elem);
-		frame = target->frame;
-		//file-backed file인 경우
-		if(target->operations->type == VM_FILE){
-			do_munmap(target->va);
+	// file-backed page가 있는 vma마다 dirty page를 한 번에 파일에 써준다. PTE는 아래의 gather가 한꺼번에 끊는다.
+	for (size_t v = 0; v < spt->vma_cnt; v++) {
+		struct vma *vma = &spt->vmas[v];
+		size_t n = pg_no(vma->end) - pg_no(vma->start);
+		for (size_t i = 0; i < n; i++) {
+			struct page *target = vma->pages[i];
+			if (target != NULL && target->operations->type == VM_FILE) {
+				mmap_writeback(vma->start, vma->end);
+				break;
+			}
 		}
 	}
-	
-	hash_destroy(&spt->spt_hash,spt_dealloc);
-	free(frame);
+
+	// 모든 매핑을 먼저 한꺼번에 끊고 TLB를 한 번만 비운다. 아래의 vm_page_unmap()은 이미 present가 아닌 PTE를 보므로 다시 비우지 않는다.
+	struct thread *curr = thread_current();
+	if (curr->pml4 != NULL) {
+		struct mmu_gather tlb;
+		mmu_gather_init(&tlb, curr->pml4);
+		for (size_t v = 0; v < spt->vma_cnt; v++) {
+			struct vma *vma = &spt->vmas[v];
+			size_t n = pg_no(vma->end) - pg_no(vma->start);
+			for (size_t i = 0; i < n; i++)
+				if (vma->pages[i] != NULL)
+					mmu_gather_clear_page(&tlb, vma->pages[i]->va);
+		}
+		mmu_gather_finish(&tlb);
+	}
+
+	for (size_t v = 0; v < spt->vma_cnt; v++) {
+		struct vma *vma = &spt->vmas[v];
+		size_t n = pg_no(vma->end) - pg_no(vma->start);
+		for (size_t i = 0; i < n; i++)
+			if (vma->pages[i] != NULL)
+				spt_dealloc(vma->pages[i]);
+		free(vma->pages);
+	}
+	free(spt->vmas);
+	supplemental_page_table_init(spt);
 }
 
-void spt_dealloc(struct hash_elem *e, void *aux){
-	struct page *page = hash_entry (e, struct page, hash_elem);
-	// destroy(page);
+static void
+spt_dealloc (struct page *page) {
+	// pager가 이 page를 내보내는 중이면 끝날 때까지 기다린다. 그래야 destroy와 frame 반환이 겹치지 않는다.
+	vm_page_settle(page);
+	destroy(page);
+	// destroy가 frame을 정리하지 않았으면 여기서 매핑을 끊고, 마지막 사용자였으면 frame을 반환한다.
+	struct frame *frame = page->frame;
+	if (frame != NULL && vm_page_unmap (page) == 0)
+		vm_frame_free (frame);
+	if (page->locked) {
+		lock_acquire (&frame_table_lock);
+		locked_pages--;
+		lock_release (&frame_table_lock);
+	}
 	ASSERT(is_user_vaddr(page->va));
 	ASSERT(is_kernel_vaddr(page));
 	free(page);
@@ -0,0 +1,411 @@
+/* zswap.c: Compressed in-memory cache in front of the swap disk.
+
+   Anonymous pages that are evicted are first compressed into a pool of
+   kernel pages.  Swapping such a page back in is then a decompression
+   instead of eight PIO sector reads.  Pages that do not compress well
+   enough, or that arrive while the pool is full, go straight to the swap
+   disk.  When the pool fills past a high watermark, the "zswapd" thread
+   writes the least recently stored entries back to the swap disk until
+   the pool drops below a low watermark.  The pool is unlocked while an
+   entry is written; loading or dropping that entry waits until it is on
+   the disk.
+
+   The codec is a small LZ77 variant in the style of LZ4: a stream of
+   sequences, each a token byte (literal length in the high nibble, match
+   length minus LZ_MIN_MATCH in the low nibble), optional length extension
+   bytes, the literals, and a 2-byte little-endian match offset.  The last
+   sequence carries literals only. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "lib/kernel/bitmap.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/anon.h"
+#include "vm/vm.h"
+
+size_t zswap_pool_pages = 64;
+
+#define ZSWAP_CHUNK 64                  /* Pool allocation unit, in bytes. */
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4) /* Larger results are rejected. */
+#define ZSWAP_HIGH_PCT 90               /* Start writeback above this. */
+#define ZSWAP_LOW_PCT 70                /* Stop writeback below this. */
+
+/* A compressed page in the pool. */
+struct zswap_entry {
+	struct page *page;          /* Owner; page->anon.zswap points here. */
+	size_t chunk;               /* First chunk in the pool. */
+	size_t chunk_cnt;           /* Number of chunks. */
+	size_t size;                /* Compressed size in bytes. */
+	bool writing;               /* Being written back, off lru. */
+	struct list_elem lru_elem;  /* Element in lru, oldest first. */
+};
+
+static struct lock zswap_lock;          /* Protects everything below. */
+static uint8_t *pool;                   /* Pool arena. */
+static struct bitmap *pool_map;         /* Used chunks of the arena. */
+static size_t pool_chunks;              /* Total chunks in the arena. */
+static size_t used_chunks;              /* Chunks in use. */
+static struct list lru;                 /* Stored entries, oldest first. */
+static struct semaphore writeback_sema; /* Wakes zswapd. */
+static struct condition writeback_done; /* An entry's writeback ended. */
+static uint8_t *writeback_buf;          /* zswapd's decompression buffer. */
+
+/* Compression output buffer and match finder, used under zswap_lock.
+   Both are too large for a kernel stack. */
+static uint8_t compress_buf[ZSWAP_MAX_SIZE];
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+static uint16_t lz_hash[1 << LZ_HASH_BITS];
+
+/* Statistics. */
+static long long store_cnt;     /* Pages stored in the pool. */
+static long long reject_cnt;    /* Pages that did not compress. */
+static long long full_cnt;      /* Pages that found the pool full. */
+static long long hit_cnt;       /* Swap-ins served from the pool. */
+static long long miss_cnt;      /* Swap-ins that went to disk. */
+static long long writeback_cnt; /* Entries written back by zswapd. */
+static size_t stored_bytes;     /* Compressed bytes in the pool. */
+static size_t stored_pages;     /* Entries in the pool. */
+
+static void zswap_writeback_thread (void *aux);
+
+/* Initializes the pool.  Called from vm_anon_init(), after the swap disk
+   is set up, since zswapd writes back through it. */
+void
+zswap_init (void) {
+	if (zswap_pool_pages == 0)
+		return;
+
+	pool = palloc_get_multiple (PAL_ZERO, zswap_pool_pages);
+	writeback_buf = palloc_get_page (0);
+	pool_chunks = zswap_pool_pages * PGSIZE / ZSWAP_CHUNK;
+	pool_map = bitmap_create (pool_chunks);
+	if (pool == NULL || writeback_buf == NULL || pool_map == NULL) {
+		printf ("zswap: cannot allocate %zu page pool, disabled\n",
+				zswap_pool_pages);
+		palloc_free_multiple (pool, zswap_pool_pages);
+		palloc_free_page (writeback_buf);
+		bitmap_destroy (pool_map);
+		pool = NULL;
+		return;
+	}
+
+	lock_init (&zswap_lock);
+	list_init (&lru);
+	sema_init (&writeback_sema, 0);
+	cond_init (&writeback_done);
+	thread_create ("zswapd", PRI_DEFAULT, zswap_writeback_thread, NULL);
+}
+
+static inline uint32_t
+lz_read32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+static inline size_t
+lz_hash_of (uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes LEN as a run of 255s and a final remainder byte. */
+static uint8_t *
+lz_put_len (uint8_t *op, size_t len) {
+	for (; len >= 255; len -= 255)
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+/* Appends one sequence to *OPP: LIT_LEN literals from LIT, then a match of
+   MATCH_LEN bytes at distance OFFSET, or no match if MATCH_LEN is 0.
+   Returns false if it does not fit before OEND. */
+static bool
+lz_emit (uint8_t **opp, uint8_t *oend, const uint8_t *lit, size_t lit_len,
+		size_t offset, size_t match_len) {
+	uint8_t *op = *opp;
+	size_t need = 1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1;
+	if ((size_t) (oend - op) < need)
+		return false;
+
+	uint8_t *token = op++;
+	*token = (lit_len < 15 ? lit_len : 15) << 4;
+	if (lit_len >= 15)
+		op = lz_put_len (op, lit_len - 15);
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+
+	if (match_len != 0) {
+		size_t ml = match_len - LZ_MIN_MATCH;
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		*token |= ml < 15 ? ml : 15;
+		if (ml >= 15)
+			op = lz_put_len (op, ml - 15);
+	}
+	*opp = op;
+	return true;
+}
+
+/* Compresses the page at SRC into DST, which has room for DST_CAP bytes.
+   Returns the compressed size, or 0 if it does not fit. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t dst_cap) {
+	const uint8_t *ip = src, *anchor = src;
+	const uint8_t *iend = src + PGSIZE;
+	uint8_t *op = dst, *oend = dst + dst_cap;
+
+	memset (lz_hash, 0, sizeof lz_hash);
+	while (ip + LZ_MIN_MATCH <= iend) {
+		uint32_t seq = lz_read32 (ip);
+		size_t h = lz_hash_of (seq);
+		const uint8_t *ref = src + lz_hash[h];
+		lz_hash[h] = ip - src;
+		if (ref >= ip || lz_read32 (ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		const uint8_t *m = ip + LZ_MIN_MATCH;
+		const uint8_t *r = ref + LZ_MIN_MATCH;
+		while (m < iend && *m == *r)
+			m++, r++;
+		if (!lz_emit (&op, oend, anchor, ip - anchor, ip - ref, m - ip))
+			return 0;
+		ip = anchor = m;
+	}
+	if (!lz_emit (&op, oend, anchor, iend - anchor, 0, 0))
+		return 0;
+	return op - dst;
+}
+
+/* Reads a length extension at *IPP, adding it to *LEN. */
+static bool
+lz_get_len (const uint8_t **ipp, const uint8_t *iend, size_t *len) {
+	const uint8_t *ip = *ipp;
+	uint8_t b;
+	do {
+		if (ip >= iend)
+			return false;
+		b = *ip++;
+		*len += b;
+	} while (b == 255);
+	*ipp = ip;
+	return true;
+}
+
+/* Decompresses SRC_LEN bytes at SRC into the page at DST.
+   Returns false if the stream is corrupt. */
+static bool
+lz_decompress (const uint8_t *src, size_t src_len, uint8_t *dst) {
+	const uint8_t *ip = src, *iend = src + src_len;
+	uint8_t *op = dst, *oend = dst + PGSIZE;
+
+	while (ip < iend) {
+		uint8_t token = *ip++;
+		size_t len = token >> 4;
+		if (len == 15 && !lz_get_len (&ip, iend, &len))
+			return false;
+		if (len > (size_t) (iend - ip) || len > (size_t) (oend - op))
+			return false;
+		memcpy (op, ip, len);
+		op += len;
+		ip += len;
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		len = token & 15;
+		if (len == 15 && !lz_get_len (&ip, iend, &len))
+			return false;
+		len += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| len > (size_t) (oend - op))
+			return false;
+
+		/* Matches may overlap their own output, so copy bytewise. */
+		const uint8_t *m = op - offset;
+		while (len-- > 0)
+			*op++ = *m++;
+	}
+	return op == oend;
+}
+
+/* Removes entry E from the pool and frees it.  Caller holds zswap_lock. */
+static void
+entry_free (struct zswap_entry *e) {
+	if (!e->writing)
+		list_remove (&e->lru_elem);
+	bitmap_set_multiple (pool_map, e->chunk, e->chunk_cnt, false);
+	used_chunks -= e->chunk_cnt;
+	stored_bytes -= e->size;
+	stored_pages--;
+	e->page->anon.zswap = NULL;
+	free (e);
+}
+
+/* Compresses PAGE, whose contents are at KVA, into the pool.
+   Returns false if the page must go to the swap disk instead. */
+bool
+zswap_store (struct page *page, const void *kva) {
+	if (pool == NULL)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	ASSERT (page->anon.zswap == NULL);
+
+	size_t size = lz_compress (kva, compress_buf, sizeof compress_buf);
+	if (size == 0) {
+		reject_cnt++;
+		lock_release (&zswap_lock);
+		return false;
+	}
+
+	size_t cnt = DIV_ROUND_UP (size, ZSWAP_CHUNK);
+	size_t chunk = bitmap_scan_and_flip (pool_map, 0, cnt, false);
+	struct zswap_entry *e = NULL;
+	if (chunk != BITMAP_ERROR) {
+		e = malloc (sizeof *e);
+		if (e == NULL)
+			bitmap_set_multiple (pool_map, chunk, cnt, false);
+	}
+	if (e == NULL) {
+		full_cnt++;
+		lock_release (&zswap_lock);
+		sema_up (&writeback_sema);
+		return false;
+	}
+
+	memcpy (pool + chunk * ZSWAP_CHUNK, compress_buf, size);
+	e->page = page;
+	e->chunk = chunk;
+	e->chunk_cnt = cnt;
+	e->size = size;
+	e->writing = false;
+	list_push_back (&lru, &e->lru_elem);
+	page->anon.zswap = e;
+
+	used_chunks += cnt;
+	stored_bytes += size;
+	stored_pages++;
+	store_cnt++;
+	bool wake = used_chunks * 100 >= pool_chunks * ZSWAP_HIGH_PCT;
+	lock_release (&zswap_lock);
+
+	if (wake)
+		sema_up (&writeback_sema);
+	return true;
+}
+
+/* Waits until PAGE's entry, if any, is not being written back, and
+   returns it then.  Caller holds zswap_lock. */
+static struct zswap_entry *
+entry_wait (struct page *page) {
+	struct zswap_entry *e;
+
+	while ((e = page->anon.zswap) != NULL && e->writing)
+		cond_wait (&writeback_done, &zswap_lock);
+	return e;
+}
+
+/* Decompresses PAGE from the pool into KVA and drops its entry.
+   Returns false if PAGE is not in the pool, including when zswapd has
+   just moved it to the swap disk. */
+bool
+zswap_load (struct page *page, void *kva) {
+	if (pool == NULL)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	struct zswap_entry *e = entry_wait (page);
+	if (e == NULL) {
+		miss_cnt++;
+		lock_release (&zswap_lock);
+		return false;
+	}
+	if (!lz_decompress (pool + e->chunk * ZSWAP_CHUNK, e->size, kva))
+		PANIC ("zswap: corrupt entry for page %p", page->va);
+	entry_free (e);
+	hit_cnt++;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* Drops PAGE's entry, if any, without reading it. */
+void
+zswap_invalidate (struct page *page) {
+	if (pool == NULL)
+		return;
+
+	lock_acquire (&zswap_lock);
+	struct zswap_entry *e = entry_wait (page);
+	if (e != NULL)
+		entry_free (e);
+	lock_release (&zswap_lock);
+}
+
+/* Writes entries back to the swap disk, oldest first, whenever the pool
+   passes the high watermark, until it is below the low watermark.
+   Each entry is taken off lru and marked writing, and zswap_lock is
+   released for the disk write.  zswap_load() and zswap_invalidate() of
+   its page wait for the mark to clear, so that they see either the entry
+   or the disk slot, never neither, and the page outlives the write. */
+static void
+zswap_writeback_thread (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&writeback_sema);
+
+		lock_acquire (&zswap_lock);
+		while (used_chunks * 100 > pool_chunks * ZSWAP_LOW_PCT
+				&& !list_empty (&lru)) {
+			struct zswap_entry *e =
+				list_entry (list_pop_front (&lru), struct zswap_entry, lru_elem);
+			if (!lz_decompress (pool + e->chunk * ZSWAP_CHUNK, e->size,
+						writeback_buf))
+				PANIC ("zswap: corrupt entry for page %p", e->page->va);
+			e->writing = true;
+			lock_release (&zswap_lock);
+
+			int slot = swap_slot_write (writeback_buf);
+
+			lock_acquire (&zswap_lock);
+			cond_broadcast (&writeback_done, &zswap_lock);
+			if (slot < 0) {
+				/* Swap is full: keep the entry, still the oldest. */
+				e->writing = false;
+				list_push_front (&lru, &e->lru_elem);
+				break;
+			}
+			e->page->anon.swap_sector = slot;
+			entry_free (e);
+			writeback_cnt++;
+		}
+		lock_release (&zswap_lock);
+	}
+}
+
+/* Prints zswap statistics. */
+void
+zswap_print_stats (void) {
+	if (pool == NULL)
+		return;
+	printf ("Zswap: %zu pages in pool (%zu%% of original size), "
+			"%lld stores, %lld hits, %lld misses, %lld rejected, "
+			"%lld pool full, %lld written back\n",
+			stored_pages,
+			stored_pages ? stored_bytes * 100 / (stored_pages * PGSIZE) : 0,
+			store_cnt, hit_cnt, miss_cnt, reject_cnt, full_cnt, writeback_cnt);
+}